@@ -1,14 +1,46 @@
 #version 460
 #extension GL_EXT_nonuniform_qualifier : require
+#extension GL_EXT_buffer_reference : require
+
+#define MATERIAL_DIFFUSE 1
+
+//set per pipeline variant, paths a variant doesn't use are compiled out
+layout(constant_id = 0) const uint FEATURES = MATERIAL_DIFFUSE;
+layout(constant_id = 1) const bool ALPHA_TEST = false;
+
+struct Material {
+	int diffuse;
+	int normal;
+	int specular;
+	uint flags;
+	vec4 baseColor;
+};
+
+layout(buffer_reference, std430) readonly buffer MaterialBuffer{
+	Material materials[];
+};
+
+layout(set = 0, binding = 0) uniform CameraData{
+	mat4 view;
+	mat4 proj;
+	MaterialBuffer materials;
+} camera;
 
 //shader input
 layout (location = 0) in vec2 uv;
-layout (location = 1) flat in int diffuse;
+layout (location = 1) flat in uint material;
 layout (set = 1, binding = 1) uniform sampler2D samplers[];
 //output write
 layout (location = 0) out vec4 fragColor;
 
 void main() 
 {
-	fragColor = texture(samplers[diffuse], uv);
+	Material m = camera.materials.materials[material];
+	vec4 color = vec4(m.baseColor.rgb, 1.0);
+	if ((FEATURES & MATERIAL_DIFFUSE) != 0)
+		color = texture(samplers[m.diffuse], uv);
+	float alpha = color.a * m.baseColor.a;
+	if (ALPHA_TEST && alpha < 0.5)
+		discard;
+	fragColor = vec4(color.rgb, alpha);
 }
@@ -2,12 +2,7 @@
 #extension GL_EXT_buffer_reference : require
 
 layout (location = 0) out vec2 uv;
-layout (location = 1) out int diffuse;
-
-layout(set = 0, binding = 0) uniform CameraData{   
-	mat4 view;
-	mat4 proj;
-} camera;
+layout (location = 1) flat out uint material;
 
 struct Vertex {
 
@@ -22,24 +17,52 @@ layout(buffer_reference, std430) readonly buffer VertexBuffer{
 	Vertex vertices[];
 };
 
+struct DrawData {
+	mat4 render_matrix;
+	VertexBuffer vertexBuffer;
+	uint material;
+	uint pad;
+};
+
+layout(buffer_reference, std430) readonly buffer DrawBuffer{
+	DrawData draws[];
+};
+
+struct Material {
+	int diffuse;
+	int normal;
+	int specular;
+	uint flags;
+	vec4 baseColor;
+};
+
+layout(buffer_reference, std430) readonly buffer MaterialBuffer{
+	Material materials[];
+};
+
+layout(set = 0, binding = 0) uniform CameraData{   
+	mat4 view;
+	mat4 proj;
+	MaterialBuffer materials;
+	DrawBuffer draws;
+} camera;
+
 //push constants block
 layout( push_constant ) uniform constants
 {	
-    int diffuse;
-    int normal;
-    int specular;
-	mat4 render_matrix;
-	VertexBuffer vertexBuffer;
+	uint drawId;
 } PushConstants;
 
 void main() 
 {	
+	DrawData draw = camera.draws.draws[PushConstants.drawId];
+
 	//load vertex data from device adress
-	Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+	Vertex v = draw.vertexBuffer.vertices[gl_VertexIndex];
 
 	//output data
-	gl_Position = camera.proj * camera.view * vec4(v.position, 1.0f);
-    diffuse = PushConstants.diffuse;
+	gl_Position = camera.proj * camera.view * draw.render_matrix * vec4(v.position, 1.0f);
+	material = draw.material;
 	uv.x = v.uv_x;
 	uv.y = v.uv_y;
 }
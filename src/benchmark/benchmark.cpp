@@ -0,0 +1,150 @@
+//Benchmark runner.
+//Renders a generated scene for a fixed number of frames through the normal frame loop, headless by
+//default, and writes percentiles of the frame timings as json to the --out file. The engine logs to
+//stdout, so the json never goes there. The same arguments always render the same frames, so numbers
+//from two builds can be compared directly.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "render/render.hpp"
+#include "render/occlusion.hpp"
+#include "render/render_queue.hpp"
+
+using namespace vkengine;
+
+namespace {
+    struct Summary {
+        double mean, p50, p90, p99, max;
+    };
+
+    Summary summarize(std::vector<double> values)
+    {
+        if (values.empty())
+            return {};
+        std::sort(values.begin(), values.end());
+        auto at = [&](double p) { return values[std::min(values.size() - 1, size_t(p * values.size()))]; };
+
+        double sum = 0;
+        for (double v : values)
+            sum += v;
+        return {sum / values.size(), at(0.5), at(0.9), at(0.99), values.back()};
+    }
+
+    void print_summary(FILE* out, const char* name, const Summary& s, bool last = false)
+    {
+        fprintf(out, "    \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n", name, s.mean, s.p50, s.p90, s.p99, s.max,
+                last ? "" : ",");
+    }
+
+    void usage(const char* exe)
+    {
+        printf("usage: %s --out file.json [--meshes n] [--instances n] [--textures n] [--texture-size n]\n"
+               "       [--seed n] [--frames n] [--warmup n] [--orbit n] [--size WxH] [--window]\n",
+               exe);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    SceneDesc     scene;
+    EngineOptions options;
+    options.headless      = true;
+    options.frames        = 1000;
+    options.cameraPath    = 500;
+    options.recordTimings = true;
+    uint32_t    warmup    = 60;
+    const char* outPath   = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool        hasValue = i + 1 < argc;
+        const char* arg      = argv[i];
+        if (!strcmp(arg, "--window"))
+            options.headless = false;
+        else if (!hasValue)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else if (!strcmp(arg, "--meshes"))
+            scene.meshes = atoi(argv[++i]);
+        else if (!strcmp(arg, "--instances"))
+            scene.instances = atoi(argv[++i]);
+        else if (!strcmp(arg, "--textures"))
+            scene.textures = atoi(argv[++i]);
+        else if (!strcmp(arg, "--texture-size"))
+            scene.textureSize = atoi(argv[++i]);
+        else if (!strcmp(arg, "--seed"))
+            scene.seed = atoi(argv[++i]);
+        else if (!strcmp(arg, "--frames"))
+            options.frames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--warmup"))
+            warmup = atoi(argv[++i]);
+        else if (!strcmp(arg, "--orbit"))
+            options.cameraPath = atoi(argv[++i]);
+        else if (!strcmp(arg, "--size"))
+            sscanf(argv[++i], "%ux%u", &options.width, &options.height);
+        else if (!strcmp(arg, "--out"))
+            outPath = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!outPath)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    options.scene = &scene;
+    //warmup frames render like any other, they are only left out of the numbers
+    options.frames += warmup;
+
+    init_engine(options);
+    run();
+    MemoryUsage memory = memory_usage();
+    uint64_t    frames = frames_rendered();
+    cleanup();
+
+    std::vector<double> interval, cpu, gpu;
+    double              draws   = 0;
+    const auto&         timings = frame_timings();
+    for (size_t i = std::min<size_t>(warmup, timings.size()); i < timings.size(); i++)
+    {
+        interval.push_back(timings[i].intervalMs);
+        cpu.push_back(timings[i].cpuMs);
+        gpu.push_back(timings[i].gpuMs);
+        draws += timings[i].draws;
+    }
+    size_t measured = interval.size();
+    SortBenchmark      sort      = benchmark_draw_key_sort(scene.instances);
+    OcclusionBenchmark occlusion = benchmark_occlusion();
+
+    FILE* out = fopen(outPath, "w");
+    if (!out)
+    {
+        printf("Failed to open %s for writing\n", outPath);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"scene\": {\"meshes\": %u, \"instances\": %u, \"textures\": %u, \"textureSize\": %u, \"seed\": %u},\n", scene.meshes, scene.instances,
+            scene.textures, scene.textureSize, scene.seed);
+    fprintf(out, "  \"run\": {\"headless\": %s, \"width\": %u, \"height\": %u, \"orbitFrames\": %u, \"warmup\": %u, \"frames\": %zu, \"rendered\": %llu},\n",
+            options.headless ? "true" : "false", options.width, options.height, options.cameraPath, warmup, measured, (unsigned long long)frames);
+    fprintf(out, "  \"frameMs\": {\n");
+    print_summary(out, "interval", summarize(interval));
+    print_summary(out, "cpu", summarize(cpu));
+    print_summary(out, "gpu", summarize(gpu), true);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"drawsPerFrame\": %.1f,\n", measured ? draws / measured : 0.0);
+    fprintf(out, "  \"memory\": {\"blockBytes\": %llu, \"allocationBytes\": %llu, \"usage\": %llu, \"budget\": %llu},\n", (unsigned long long)memory.blockBytes,
+            (unsigned long long)memory.allocationBytes, (unsigned long long)memory.usage, (unsigned long long)memory.budget);
+    fprintf(out, "  \"drawKeySort\": {\"count\": %u, \"radixMs\": %.4f, \"stdSortMs\": %.4f},\n", sort.count, sort.radixMs, sort.stdSortMs);
+    fprintf(out, "  \"occlusionRaster\": {\"triangles\": %u, \"avx2\": %s, \"avx2Ms\": %.4f, \"scalarMs\": %.4f, \"mismatches\": %u}\n", occlusion.triangles,
+            occlusion.simd ? "true" : "false", occlusion.simdMs, occlusion.scalarMs, occlusion.mismatches);
+    fprintf(out, "}\n");
+    fclose(out);
+}
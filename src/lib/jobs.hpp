@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "profiler.hpp"
+
+//minimal worker pool, jobs are run in submission order by whichever worker is free
+struct JobPool
+{
+    void init(uint32_t threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1)
+    {
+        stop = false;
+        for (uint32_t i = 0; i < threadCount; i++)
+            workers.emplace_back([this]() { worker_loop(); });
+    }
+
+    void shutdown()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers)
+            t.join();
+        workers.clear();
+    }
+
+    uint32_t size() const { return workers.size(); }
+
+    void submit(std::function<void()>&& job)
+    {
+        {
+            std::lock_guard lock(mutex);
+            jobs.push_back(std::move(job));
+            pending++;
+        }
+        wake.notify_one();
+    }
+
+    //blocks until every job submitted so far has finished
+    void wait()
+    {
+        std::unique_lock lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+    }
+
+    //runs fn(i) for i in [0, count), the calling thread takes part too
+    template <typename F>
+    void parallel_for(uint32_t count, F&& fn)
+    {
+        for (uint32_t i = 1; i < count; i++)
+            submit([&fn, i]() { fn(i); });
+        if (count > 0)
+            fn(0);
+        wait();
+    }
+
+  private:
+    void worker_loop()
+    {
+        PROFILE_THREAD_NAME("worker");
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this]() { return stop || !jobs.empty(); });
+                if (stop && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+
+            std::lock_guard lock(mutex);
+            if (--pending == 0)
+                done.notify_all();
+        }
+    }
+
+    std::vector<std::thread>          workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex                        mutex;
+    std::condition_variable           wake;
+    std::condition_variable           done;
+    uint32_t                          pending = 0;
+    bool                              stop    = false;
+};
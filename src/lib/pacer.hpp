@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#if defined(__linux__)
+#include <cerrno>
+#include <time.h>
+#endif
+
+//frame limiter that sleeps until shortly before the deadline and spins for the rest.
+//the spin margin follows how late the OS has been waking us up, so the core is idle for most of the wait
+struct FramePacer
+{
+    using clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t SAMPLE_COUNT = 256;
+
+    //how long before the deadline to stop sleeping
+    std::chrono::nanoseconds spinMargin = std::chrono::microseconds(1000);
+    //time spent spinning in the last wait
+    std::chrono::nanoseconds lastSpin{0};
+
+    //waits until one period after the previous deadline. Missed deadlines are not caught up on,
+    //the next one is counted from now
+    void wait(std::chrono::nanoseconds period)
+    {
+        auto now = clock::now();
+        deadline += period;
+        if (deadline <= now)
+        {
+            //an overrun is the worst jitter there is, it has to show up in the samples
+            lastSpin                              = std::chrono::nanoseconds(0);
+            samples[sampleCount++ % SAMPLE_COUNT] = now - deadline;
+            deadline                              = now;
+            return;
+        }
+
+        auto sleepTarget = deadline - spinMargin;
+        if (sleepTarget > now)
+        {
+            sleep_until(sleepTarget);
+            auto woke = clock::now();
+            //late wakeups grow the margin straight away, it shrinks back slowly when the OS is punctual
+            auto oversleep = woke - sleepTarget + std::chrono::microseconds(100);
+            spinMargin     = std::max(std::chrono::nanoseconds(oversleep), spinMargin * 31 / 32);
+            spinMargin     = std::clamp(spinMargin, std::chrono::nanoseconds(std::chrono::microseconds(200)), std::chrono::nanoseconds(std::chrono::milliseconds(4)));
+        }
+
+        auto spinStart = clock::now();
+        while (clock::now() < deadline)
+            std::this_thread::yield();
+        auto end = clock::now();
+        lastSpin = end - spinStart;
+
+        samples[sampleCount++ % SAMPLE_COUNT] = end - deadline;
+    }
+
+    //starts pacing over from t without a sample, for when the caller waited on something else, like
+    //events while idle. The next deadline is one period after t
+    void reset(clock::time_point t) { deadline = t; }
+
+    static void sleep_until(clock::time_point t)
+    {
+#if defined(__linux__)
+        //steady_clock is CLOCK_MONOTONIC with libstdc++ and libc++
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+        timespec ts = {time_t(ns / 1000000000), long(ns % 1000000000)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+            ;
+#else
+        std::this_thread::sleep_until(t);
+#endif
+    }
+
+    //how late each of the last SAMPLE_COUNT paced frames ended up, missed deadlines included, p in [0, 1]
+    std::chrono::nanoseconds jitter(double p) const
+    {
+        uint32_t count = std::min(sampleCount, SAMPLE_COUNT);
+        if (count == 0)
+            return std::chrono::nanoseconds(0);
+
+        std::chrono::nanoseconds sorted[SAMPLE_COUNT];
+        std::copy(samples, samples + count, sorted);
+        uint32_t n = std::min(count - 1, uint32_t(p * count));
+        std::nth_element(sorted, sorted + n, sorted + count);
+        return sorted[n];
+    }
+
+  private:
+    clock::time_point        deadline = clock::now();
+    std::chrono::nanoseconds samples[SAMPLE_COUNT];
+    uint32_t                 sampleCount = 0;
+};
@@ -0,0 +1,240 @@
+#pragma once
+//Scoped CPU profiler.
+//PROFILE_ZONE("name") times the rest of the enclosing scope. Every thread writes finished zones to its
+//own ring buffer, so recording is two timestamp reads and a store with no locks or shared cache lines.
+//Readers copy the rings without stopping the writers and drop whatever may have been overwritten
+//while they copied. A ring is released when its thread exits and handed to the next thread that
+//registers, so threads that come and go don't use up MAX_THREADS. Compiled in for DBG builds or with
+//VKENGINE_PROFILE, everywhere else the macros are empty.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#endif
+
+#if defined(DBG) || defined(VKENGINE_PROFILE)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+
+struct CpuProfiler
+{
+    static constexpr uint32_t RING_SIZE   = 1 << 14;
+    static constexpr uint32_t MAX_THREADS = 64;
+
+    struct Zone
+    {
+        const char* name;
+        uint64_t    start;
+        uint64_t    end;
+        uint32_t    depth;
+    };
+
+    struct ThreadRing
+    {
+        Zone                  zones[RING_SIZE];
+        //zones ever written, only the owning thread stores to it
+        std::atomic<uint64_t> head = 0;
+        //head when the current owner took the ring over, the zones before it belong to an exited thread
+        std::atomic<uint64_t> base = 0;
+        std::atomic<bool>     owned = true;
+        uint32_t              depth = 0;
+        uint32_t              id    = 0;
+        char                  name[32] = "thread";
+    };
+
+    //a finished zone in nanoseconds since the profiler started
+    struct Event
+    {
+        const char* name;
+        uint64_t    start;
+        uint64_t    end;
+        uint32_t    depth;
+        uint32_t    thread;
+    };
+
+    std::atomic<bool> paused = false;
+
+    //raw timestamps, the tsc on x86 since it is much cheaper than a clock_gettime
+    static uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    ThreadRing& ring()
+    {
+        //gives the ring back when the thread exits
+        struct Owner
+        {
+            ThreadRing* ring;
+            ~Owner() { ring->owned.store(false, std::memory_order_release); }
+        };
+        thread_local Owner local = {register_thread()};
+        return *local.ring;
+    }
+
+    void set_thread_name(const char* name)
+    {
+        ThreadRing& r = ring();
+        snprintf(r.name, sizeof(r.name), "%s", name);
+    }
+
+    void begin() { ring().depth++; }
+
+    void end(const char* name, uint64_t start)
+    {
+        uint64_t    now = ticks();
+        ThreadRing& r   = ring();
+        r.depth--;
+        if (paused.load(std::memory_order_relaxed))
+            return;
+        uint64_t head              = r.head.load(std::memory_order_relaxed);
+        r.zones[head % RING_SIZE] = {name, start, now, r.depth};
+        r.head.store(head + 1, std::memory_order_release);
+    }
+
+    //every zone still in the rings that ended after sinceNs, in no particular order
+    void collect(std::vector<Event>& out, uint64_t sinceNs = 0)
+    {
+        uint32_t count = std::min(threadCount.load(std::memory_order_acquire), MAX_THREADS);
+        for (uint32_t t = 0; t < count; t++)
+        {
+            ThreadRing* r = rings[t].load(std::memory_order_acquire);
+            if (!r)
+                continue;
+            uint64_t head  = r->head.load(std::memory_order_acquire);
+            uint64_t first = std::max(head > RING_SIZE ? head - RING_SIZE : 0, r->base.load(std::memory_order_acquire));
+            size_t   begin = out.size();
+            for (uint64_t i = first; i < head; i++)
+            {
+                const Zone& z = r->zones[i % RING_SIZE];
+                out.push_back({z.name, to_ns(z.start), to_ns(z.end), z.depth, r->id});
+            }
+            //the writer kept going while we copied, anything it lapped is torn. That includes the slot
+            //of zone lapped itself, which it may be writing right now
+            uint64_t lapped = r->head.load(std::memory_order_acquire);
+            uint64_t valid  = lapped >= RING_SIZE ? lapped - RING_SIZE + 1 : 0;
+            size_t   drop   = size_t(std::min(head, std::max(valid, first)) - first);
+            out.erase(out.begin() + begin, out.begin() + begin + drop);
+            out.erase(std::remove_if(out.begin() + begin, out.end(), [&](const Event& e) { return e.end < sinceNs; }), out.end());
+        }
+    }
+
+    const char* thread_name(uint32_t id)
+    {
+        ThreadRing* r = id < MAX_THREADS ? rings[id].load(std::memory_order_acquire) : nullptr;
+        return r ? r->name : "?";
+    }
+
+    uint64_t now_ns() { return to_ns(ticks()); }
+
+    //chrome://tracing and ui.perfetto.dev both read this
+    bool write_chrome_trace(const char* path)
+    {
+        std::vector<Event> events;
+        collect(events);
+        FILE* file = fopen(path, "w");
+        if (!file)
+            return false;
+
+        fprintf(file, "{\"traceEvents\":[\n");
+        uint32_t count = std::min(threadCount.load(std::memory_order_acquire), MAX_THREADS);
+        for (uint32_t t = 0; t < count; t++)
+            fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n", t, thread_name(t));
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            const Event& e = events[i];
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n", e.name, e.thread, e.start / 1000.0,
+                    (e.end - e.start) / 1000.0, i + 1 < events.size() ? "," : "");
+        }
+        fprintf(file, "]}\n");
+        fclose(file);
+        return true;
+    }
+
+  private:
+    ThreadRing* register_thread()
+    {
+        //rings live as long as the process, a reader may still be copying one after its thread exited
+        uint32_t count = std::min(threadCount.load(std::memory_order_acquire), MAX_THREADS);
+        for (uint32_t t = 0; t < count; t++)
+        {
+            ThreadRing* r     = rings[t].load(std::memory_order_acquire);
+            bool        owned = false;
+            if (r && r->owned.compare_exchange_strong(owned, true, std::memory_order_acq_rel))
+            {
+                r->depth = 0;
+                snprintf(r->name, sizeof(r->name), "thread");
+                r->base.store(r->head.load(std::memory_order_relaxed), std::memory_order_release);
+                return r;
+            }
+        }
+
+        ThreadRing* r = new ThreadRing;
+        uint32_t    i = threadCount.fetch_add(1, std::memory_order_acq_rel);
+        r->id         = i;
+        if (i < MAX_THREADS)
+            rings[i].store(r, std::memory_order_release);
+        return r;
+    }
+
+    uint64_t to_ns(uint64_t t)
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        //the tsc rate is measured against steady_clock once, over the first few ms of profiling
+        if (nsPerTick == 0)
+        {
+            auto     c0 = std::chrono::steady_clock::now();
+            uint64_t t0 = ticks();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            auto     c1 = std::chrono::steady_clock::now();
+            uint64_t t1 = ticks();
+            nsPerTick   = double(std::chrono::duration_cast<std::chrono::nanoseconds>(c1 - c0).count()) / double(t1 - t0);
+        }
+        return t > origin ? uint64_t((t - origin) * nsPerTick) : 0;
+#else
+        return t > origin ? t - origin : 0;
+#endif
+    }
+
+    std::atomic<ThreadRing*> rings[MAX_THREADS] = {};
+    std::atomic<uint32_t>    threadCount        = 0;
+    uint64_t                 origin             = ticks();
+    double                   nsPerTick          = 0;
+};
+
+inline CpuProfiler profiler;
+
+struct ProfileScope
+{
+    const char* name;
+    uint64_t    start;
+
+    ProfileScope(const char* _name) : name(_name)
+    {
+        profiler.begin();
+        start = CpuProfiler::ticks();
+    }
+    ~ProfileScope() { profiler.end(name, start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#if PROFILER_ENABLED
+//name has to outlive the profiler, string literals do
+#define PROFILE_ZONE(name)        ProfileScope PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) profiler.set_thread_name(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD_NAME(name)
+#endif
@@ -1,7 +1,28 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "render/render.hpp"
 
-int main() {
-    vkengine::init_engine();
+int main(int argc, char** argv) {
+    vkengine::EngineOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--headless"))
+            options.headless = true;
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            options.frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--size") && i + 1 < argc)
+            sscanf(argv[++i], "%ux%u", &options.width, &options.height);
+        else if (!strcmp(argv[i], "--readback") && i + 1 < argc)
+            options.readback = argv[++i];
+        else {
+            printf("usage: %s [--headless] [--frames n] [--size WxH] [--readback out.ppm]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    vkengine::init_engine(options);
     vkengine::run();
+    if (options.headless)
+        printf("%llu frames rendered\n", (unsigned long long)vkengine::frames_rendered());
     vkengine::cleanup();
 }
@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <vector>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "async_compute.hpp"
+
+using namespace vkengine;
+
+void AsyncCompute::init(bool queueCreated)
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(spock::ctx.physicalDevice, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(spock::ctx.physicalDevice, &count, families.data());
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if ((families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && i != spock::ctx.graphicsQueueFamily)
+        {
+            family = i;
+            break;
+        }
+    }
+
+    if (family == UINT32_MAX)
+    {
+        printf("No dedicated compute queue, compute passes stay on the graphics queue\n");
+        return;
+    }
+
+    //getting a queue the device wasn't created with is invalid usage
+    if (!queueCreated)
+    {
+        printf("Async compute needs a queue in the compute family, compute passes stay on the graphics queue\n");
+        family = UINT32_MAX;
+        return;
+    }
+    vkGetDeviceQueue(spock::ctx.device, family, 0, &queue);
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        VkCommandPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex        = family;
+        VK_CHECK(vkCreateCommandPool(spock::ctx.device, &poolInfo, nullptr, &pools[i]));
+
+        VkCommandBufferAllocateInfo allocInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool                 = pools[i];
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = 1;
+        VK_CHECK(vkAllocateCommandBuffers(spock::ctx.device, &allocInfo, &buffers[i]));
+
+        //signalled, so the first wait on a slot that never submitted returns straight away
+        VkFenceCreateInfo fenceInfo = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+        VK_CHECK(vkCreateFence(spock::ctx.device, &fenceInfo, nullptr, &fences[i]));
+
+        VkSemaphoreCreateInfo semaphoreInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        VK_CHECK(vkCreateSemaphore(spock::ctx.device, &semaphoreInfo, nullptr, &computeDone[i]));
+        VK_CHECK(vkCreateSemaphore(spock::ctx.device, &semaphoreInfo, nullptr, &graphicsDone[i]));
+    }
+
+    enabled = true;
+    printf("Async compute on queue family %u\n", family);
+}
+
+void AsyncCompute::destroy()
+{
+    if (!enabled)
+        return;
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        vkDestroyCommandPool(spock::ctx.device, pools[i], nullptr);
+        vkDestroyFence(spock::ctx.device, fences[i], nullptr);
+        vkDestroySemaphore(spock::ctx.device, computeDone[i], nullptr);
+        vkDestroySemaphore(spock::ctx.device, graphicsDone[i], nullptr);
+    }
+    pendingGraphics = UINT32_MAX;
+    enabled         = false;
+}
+
+VkCommandBuffer AsyncCompute::begin_frame(uint32_t frameIndex)
+{
+    if (!enabled)
+        return VK_NULL_HANDLE;
+
+    //the frame fence only covers the graphics submit, the compute one has to be waited on separately
+    VK_CHECK(vkWaitForFences(spock::ctx.device, 1, &fences[frameIndex], true, 1000000000));
+
+    VK_CHECK(vkResetCommandPool(spock::ctx.device, pools[frameIndex], 0));
+    VkCommandBufferBeginInfo beginInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(buffers[frameIndex], &beginInfo));
+    return buffers[frameIndex];
+}
+
+bool AsyncCompute::submit(uint32_t frameIndex, bool recorded)
+{
+    if (!enabled)
+        return false;
+    VK_CHECK(vkEndCommandBuffer(buffers[frameIndex]));
+    if (!recorded)
+        return false;
+
+    VkCommandBufferSubmitInfo cmdInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = buffers[frameIndex]};
+    //the previous graphics frame may still be reading what this frame's compute passes overwrite
+    VkSemaphoreSubmitInfo waitInfo   = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    VkSemaphoreSubmitInfo signalInfo = {.sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                        .semaphore = computeDone[frameIndex],
+                                        .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+
+    VkSubmitInfo2 submit            = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submit.commandBufferInfoCount   = 1;
+    submit.pCommandBufferInfos      = &cmdInfo;
+    submit.signalSemaphoreInfoCount = 1;
+    submit.pSignalSemaphoreInfos    = &signalInfo;
+    if (pendingGraphics != UINT32_MAX)
+    {
+        waitInfo.semaphore            = graphicsDone[pendingGraphics];
+        submit.waitSemaphoreInfoCount = 1;
+        submit.pWaitSemaphoreInfos    = &waitInfo;
+        pendingGraphics               = UINT32_MAX;
+    }
+    VK_CHECK(vkResetFences(spock::ctx.device, 1, &fences[frameIndex]));
+    VK_CHECK(vkQueueSubmit2(queue, 1, &submit, fences[frameIndex]));
+    return true;
+}
+
+VkSemaphoreSubmitInfo AsyncCompute::graphics_wait(uint32_t frameIndex, bool computeSubmitted, VkPipelineStageFlags2 stage)
+{
+    if (computeSubmitted)
+    {
+        if (stage == VK_PIPELINE_STAGE_2_NONE)
+            stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        return {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .semaphore = computeDone[frameIndex], .stageMask = stage};
+    }
+    if (pendingGraphics == UINT32_MAX)
+        return {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+
+    //nothing on the compute queue consumed the last graphics signal, a binary semaphore can't be signalled
+    //again before it is waited on. It was signalled by earlier work on this queue, so the wait blocks nothing
+    VkSemaphore semaphore = graphicsDone[pendingGraphics];
+    pendingGraphics       = UINT32_MAX;
+    return {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .semaphore = semaphore, .stageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT};
+}
+
+VkSemaphoreSubmitInfo AsyncCompute::graphics_signal(uint32_t frameIndex)
+{
+    pendingGraphics = frameIndex;
+    return {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .semaphore = graphicsDone[frameIndex], .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+}
@@ -0,0 +1,45 @@
+#pragma once
+//Async compute queue.
+//Passes the render graph moves to the compute queue are recorded into a per frame command buffer and
+//submitted ahead of the graphics work. Binary semaphores order the queues, so it works on any device
+//with the queue: graphics waits on the compute work of its own frame, and compute waits on the
+//previous graphics frame so it never overwrites images that frame is still reading. Every graphics
+//signal is waited on exactly once, by the next compute submit or, in frames without compute work, by
+//the next graphics submit.
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+#include "present.hpp"
+
+namespace vkengine {
+    struct AsyncCompute {
+        bool     enabled = false;
+        uint32_t family  = UINT32_MAX;
+        VkQueue  queue   = VK_NULL_HANDLE;
+
+        //looks for a queue family with compute but no graphics, stays disabled if there isn't one. queueCreated
+        //says whether the device was created with a queue in every family, without it everything stays on
+        //the graphics queue
+        void init(bool queueCreated);
+        void destroy();
+
+        //waits until the compute work this frame slot submitted last time has finished and starts recording
+        VkCommandBuffer begin_frame(uint32_t frameIndex);
+        //submits the frame's compute work if anything was recorded, returns whether it did
+        bool            submit(uint32_t frameIndex, bool recorded);
+
+        //added to the graphics submit, both only while enabled. The wait is for this frame's compute work at
+        //stage, or without any, for the previous graphics signal nobody waited on. Its semaphore is
+        //VK_NULL_HANDLE when there is neither
+        VkSemaphoreSubmitInfo graphics_wait(uint32_t frameIndex, bool computeSubmitted, VkPipelineStageFlags2 stage);
+        VkSemaphoreSubmitInfo graphics_signal(uint32_t frameIndex);
+
+      private:
+        VkCommandPool   pools[MAX_FRAMES_IN_FLIGHT];
+        VkCommandBuffer buffers[MAX_FRAMES_IN_FLIGHT];
+        VkFence         fences[MAX_FRAMES_IN_FLIGHT];
+        VkSemaphore     computeDone[MAX_FRAMES_IN_FLIGHT];
+        VkSemaphore     graphicsDone[MAX_FRAMES_IN_FLIGHT];
+        //frame slot whose graphicsDone is signalled but not waited on yet
+        uint32_t        pendingGraphics = UINT32_MAX;
+    };
+}
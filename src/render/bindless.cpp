@@ -0,0 +1,133 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include "descriptors.hpp"
+#include "bindless.hpp"
+
+using namespace vkengine;
+
+static constexpr VkDescriptorType descriptorTypes[BINDLESS_TypeCount] = {
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+};
+
+void BindlessRegistry::init(VkDescriptorSet _set, const Slots (&slots)[BINDLESS_TypeCount], uint32_t _framesInFlight)
+{
+    set            = _set;
+    framesInFlight = _framesInFlight;
+    for (int i = 0; i < BINDLESS_TypeCount; i++)
+    {
+        assert(slots[i].capacity <= 0x10000);
+        pools[i]       = {};
+        pools[i].slots = slots[i];
+        //generation 0 is reserved so that a zero handle is never valid
+        pools[i].generations.assign(slots[i].capacity, 1);
+    }
+}
+
+BindlessHandle BindlessRegistry::acquire(BindlessType type)
+{
+    Pool&    pool = pools[type];
+    uint32_t index;
+    if (!pool.freeList.empty())
+    {
+        index = pool.freeList.back();
+        pool.freeList.pop_back();
+    }
+    else if (pool.next < pool.slots.capacity)
+    {
+        index = pool.next++;
+    }
+    else
+    {
+        printf("Bindless registry out of slots for binding %u (%u live)\n", pool.slots.binding, pool.live);
+        abort();
+    }
+
+    pool.live++;
+    return {index | uint32_t(pool.generations[index]) << 16 | uint32_t(type) << 30};
+}
+
+BindlessHandle BindlessRegistry::add_sampled_image(VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+    if (view == VK_NULL_HANDLE)
+        return {};
+    BindlessHandle handle = acquire(BINDLESS_SampledImage);
+    PendingWrite&  write  = pending.emplace_back(PendingWrite{BINDLESS_SampledImage, handle.index()});
+    write.image           = {sampler, view, layout};
+    return handle;
+}
+
+BindlessHandle BindlessRegistry::add_storage_image(VkImageView view)
+{
+    if (view == VK_NULL_HANDLE)
+        return {};
+    BindlessHandle handle = acquire(BINDLESS_StorageImage);
+    PendingWrite&  write  = pending.emplace_back(PendingWrite{BINDLESS_StorageImage, handle.index()});
+    write.image           = {VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL};
+    return handle;
+}
+
+BindlessHandle BindlessRegistry::add_storage_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    if (buffer == VK_NULL_HANDLE)
+        return {};
+    BindlessHandle handle = acquire(BINDLESS_StorageBuffer);
+    PendingWrite&  write  = pending.emplace_back(PendingWrite{BINDLESS_StorageBuffer, handle.index()});
+    write.buffer          = {buffer, offset, range};
+    return handle;
+}
+
+bool BindlessRegistry::alive(BindlessHandle handle) const
+{
+    return handle.valid() && pools[handle.type()].generations[handle.index()] == handle.generation();
+}
+
+void BindlessRegistry::remove(BindlessHandle handle)
+{
+    if (!alive(handle))
+        return;
+
+    Pool& pool = pools[handle.type()];
+    //bump the generation straight away so the old handle stops resolving, but keep the slot
+    //out of circulation until the frames that might still sample it are done
+    uint16_t& generation = pool.generations[handle.index()];
+    generation           = generation == 0x3FFF ? 1 : generation + 1;
+    pool.retired.push_back({handle.index(), frameIdx + framesInFlight});
+    pool.live--;
+}
+
+void BindlessRegistry::flush(uint64_t _frameIdx)
+{
+    frameIdx = _frameIdx;
+    for (Pool& pool : pools)
+    {
+        while (!pool.retired.empty() && pool.retired.front().frame <= frameIdx)
+        {
+            pool.freeList.push_back(pool.retired.front().index);
+            pool.retired.pop_front();
+        }
+    }
+
+    if (pending.empty())
+        return;
+
+    std::vector<VkWriteDescriptorSet> writes(pending.size());
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        const PendingWrite& p = pending[i];
+        writes[i]                 = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        writes[i].dstSet          = set;
+        writes[i].dstBinding      = pools[p.type].slots.binding;
+        writes[i].dstArrayElement = p.index;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType  = descriptorTypes[p.type];
+        if (p.type == BINDLESS_StorageBuffer)
+            writes[i].pBufferInfo = &p.buffer;
+        else
+            writes[i].pImageInfo = &p.image;
+    }
+    write_descriptor_sets(writes.size(), writes.data());
+    pending.clear();
+}
@@ -0,0 +1,86 @@
+#pragma once
+//Bindless resource registry.
+//Hands out slots in the bindless descriptor set for sampled images, storage images and storage buffers.
+//Handles carry a generation so stale handles can be detected, released slots only go back on the free
+//list once every frame that could still be reading them has retired, and descriptor writes are
+//batched and flushed once per frame.
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace vkengine {
+    enum BindlessType {
+        BINDLESS_SampledImage  = 0,
+        BINDLESS_StorageImage  = 1,
+        BINDLESS_StorageBuffer = 2,
+        BINDLESS_TypeCount
+    };
+
+    //index:16 | generation:14 | type:2, zero is never a valid handle
+    struct BindlessHandle {
+        uint32_t value = 0;
+
+        uint32_t     index() const { return value & 0xFFFF; }
+        uint32_t     generation() const { return (value >> 16) & 0x3FFF; }
+        BindlessType type() const { return BindlessType(value >> 30); }
+        bool         valid() const { return value != 0; }
+
+        bool operator==(const BindlessHandle&) const = default;
+    };
+
+    struct BindlessRegistry {
+        struct Slots {
+            uint32_t binding  = 0;
+            uint32_t capacity = 0;
+        };
+
+        void init(VkDescriptorSet set, const Slots (&slots)[BINDLESS_TypeCount], uint32_t framesInFlight);
+
+        BindlessHandle add_sampled_image(VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        BindlessHandle add_storage_image(VkImageView view);
+        BindlessHandle add_storage_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        //the slot is recycled once the frames in flight that could use it have finished
+        void           remove(BindlessHandle handle);
+        bool           alive(BindlessHandle handle) const;
+
+        //writes all pending descriptors in one call and recycles retired slots, call once per frame
+        //after the frame's fence wait
+        void     flush(uint64_t frameIdx);
+
+        uint32_t live(BindlessType type) const { return pools[type].live; }
+        uint32_t capacity(BindlessType type) const { return pools[type].slots.capacity; }
+
+      private:
+        struct Retired {
+            uint32_t index;
+            uint64_t frame;
+        };
+
+        struct Pool {
+            Slots                 slots;
+            uint32_t              next = 0;
+            uint32_t              live = 0;
+            std::vector<uint16_t> generations;
+            std::vector<uint32_t> freeList;
+            std::deque<Retired>   retired;
+        };
+
+        struct PendingWrite {
+            BindlessType type;
+            uint32_t     index;
+            union {
+                VkDescriptorImageInfo  image;
+                VkDescriptorBufferInfo buffer;
+            };
+        };
+
+        BindlessHandle acquire(BindlessType type);
+
+        VkDescriptorSet           set = VK_NULL_HANDLE;
+        Pool                      pools[BINDLESS_TypeCount];
+        uint32_t                  framesInFlight = 0;
+        uint64_t                  frameIdx       = 0;
+        std::vector<PendingWrite> pending;
+    };
+}
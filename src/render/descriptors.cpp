@@ -0,0 +1,59 @@
+#include <cstdio>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "descriptors.hpp"
+
+using namespace vkengine;
+
+VkDescriptorSet vkengine::allocate_descriptor_set(VkDescriptorSetLayout layout)
+{
+    descriptorStats.allocations++;
+    return spock::ctx.descriptorAllocator.allocate(layout);
+}
+
+void vkengine::write_descriptor_sets(uint32_t count, const VkWriteDescriptorSet* writes)
+{
+    if (count == 0)
+        return;
+    descriptorStats.writes += count;
+    vkUpdateDescriptorSets(spock::ctx.device, count, writes, 0, nullptr);
+}
+
+void vkengine::write_image_descriptor(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler)
+{
+    VkDescriptorImageInfo info  = {sampler, view, layout};
+    VkWriteDescriptorSet  write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet                = set;
+    write.dstBinding            = binding;
+    write.descriptorCount       = 1;
+    write.descriptorType        = type;
+    write.pImageInfo            = &info;
+    write_descriptor_sets(1, &write);
+}
+
+void vkengine::write_buffer_descriptor(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo info  = {buffer, offset, range};
+    VkWriteDescriptorSet   write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet                 = set;
+    write.dstBinding             = binding;
+    write.descriptorCount        = 1;
+    write.descriptorType         = type;
+    write.pBufferInfo            = &info;
+    write_descriptor_sets(1, &write);
+}
+
+void vkengine::end_descriptor_frame()
+{
+#ifdef DBG
+    if (descriptorStats.allocations)
+        printf("Warning: %u descriptor sets allocated during frame %u\n", descriptorStats.allocations, uint32_t(spock::ctx.frameIdx));
+#endif
+    frameDescriptorStats = descriptorStats;
+    descriptorStats      = {};
+}
+
+void vkengine::reset_descriptor_stats()
+{
+    descriptorStats = {};
+}
@@ -0,0 +1,29 @@
+#pragma once
+//Counted descriptor allocation and writes.
+//The main passes only use persistent sets, anything going through here during a frame shows up in
+//the per frame counters, so churn in the hot loop is visible straight away.
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+namespace vkengine {
+    struct DescriptorStats {
+        uint32_t allocations = 0;
+        uint32_t writes      = 0;
+    };
+
+    //counts of the frame being recorded, and of the last finished frame
+    inline DescriptorStats descriptorStats;
+    inline DescriptorStats frameDescriptorStats;
+
+    //allocates from the persistent allocator, sets live until the engine shuts down
+    VkDescriptorSet allocate_descriptor_set(VkDescriptorSetLayout layout);
+    void            write_descriptor_sets(uint32_t count, const VkWriteDescriptorSet* writes);
+    //single descriptor writes, counted the same way
+    void            write_image_descriptor(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout,
+                                           VkSampler sampler = VK_NULL_HANDLE);
+    void            write_buffer_descriptor(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+    //publishes the frame's counts and starts the next frame's, warns about allocations in DBG builds
+    void            end_descriptor_frame();
+    //drops the counts without publishing them, for the setup done before the first frame
+    void            reset_descriptor_stats();
+}
@@ -0,0 +1,27 @@
+#include "frame_snapshot.hpp"
+
+using namespace vkengine;
+
+void FrameSnapshot::capture_imgui(const ImDrawData* drawData)
+{
+    for (ImDrawList* list : imgui.CmdLists)
+        IM_DELETE(list);
+    imgui.Clear();
+
+    imgui.Valid            = drawData->Valid;
+    imgui.TotalIdxCount    = drawData->TotalIdxCount;
+    imgui.TotalVtxCount    = drawData->TotalVtxCount;
+    imgui.DisplayPos       = drawData->DisplayPos;
+    imgui.DisplaySize      = drawData->DisplaySize;
+    imgui.FramebufferScale = drawData->FramebufferScale;
+    imgui.OwnerViewport    = drawData->OwnerViewport;
+    for (int i = 0; i < drawData->CmdListsCount; i++)
+        imgui.CmdLists.push_back(drawData->CmdLists[i]->CloneOutput());
+    imgui.CmdListsCount = imgui.CmdLists.Size;
+}
+
+FrameSnapshot::~FrameSnapshot()
+{
+    for (ImDrawList* list : imgui.CmdLists)
+        IM_DELETE(list);
+}
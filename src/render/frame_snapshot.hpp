@@ -0,0 +1,120 @@
+#pragma once
+//Frame snapshots handed from the simulation thread to the render thread.
+//The main thread polls input, steps the simulation, culls and sorts the draw list and builds the UI,
+//then publishes everything the frame needs as one immutable snapshot. The render thread records and
+//submits from it while the main thread is already building the next one. Slots go back to the
+//producer carrying the render thread's stats for the frame they described.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan_core.h>
+#include "imgui.h"
+#include "texgui.h"
+#include "descriptors.hpp"
+#include "gpu_profiler.hpp"
+#include "latency.hpp"
+#include "present.hpp"
+#include "render_graph.hpp"
+#include "render_queue.hpp"
+
+namespace vkengine {
+    //filled by the render thread, only valid once the slot is back with the producer
+    struct FrameStats {
+        DescriptorStats  descriptors;
+        uint32_t         bindlessLive[3] = {};
+        uint32_t         draws           = 0;
+        uint32_t         recordChunks    = 0;
+        RenderGraphStats graph;
+        PresentStats     present;
+        FrameLatency     latency;
+        //results of an earlier frame, see GpuProfiler
+        GpuFrameProfile  gpuPasses;
+    };
+
+    struct FrameSnapshot {
+        glm::mat4                             view;
+        glm::mat4                             proj;
+        VkExtent2D                            extent;
+        bool                                  parallelRecording;
+        bool                                  gpuProfile;
+        //present settings are applied by the render thread, it owns the swapchain
+        VkPresentModeKHR                      presentMode;
+        bool                                  presentThread;
+        uint32_t                              framesInFlight;
+        //when the main thread started the frame and last sampled input for it
+        std::chrono::steady_clock::time_point frameStart;
+        std::chrono::steady_clock::time_point inputTime;
+        //visible draws, already sorted
+        RenderQueue                           queue;
+        TexGui::RenderData                    ui;
+        FrameStats                            stats;
+
+        //deep copies the draw lists, the ones ImGui owns are reused by the next ImGui::NewFrame
+        void          capture_imgui(const ImDrawData* drawData);
+        ImDrawData*   imgui_draw_data() { return &imgui; }
+        ~FrameSnapshot();
+
+      private:
+        ImDrawData imgui;
+    };
+
+    //single producer single consumer ring of snapshots. With 2 slots the producer can build one frame
+    //while the render thread works on the previous one, 3 lets it run a further frame ahead
+    template <uint32_t N>
+    struct SnapshotQueue {
+        static_assert(N >= 2, "one slot for each side at least");
+
+        //blocks while every slot is still waiting to be rendered
+        FrameSnapshot* begin_write()
+        {
+            uint64_t p = produced.load(std::memory_order_relaxed);
+            for (uint64_t c = consumed.load(std::memory_order_acquire); p - c == N; c = consumed.load(std::memory_order_acquire))
+                consumed.wait(c, std::memory_order_acquire);
+            return &slots[p % N];
+        }
+        void publish()
+        {
+            produced.fetch_add(1, std::memory_order_release);
+            produced.notify_one();
+        }
+        //blocks until the render thread has finished every published snapshot, returns the last one
+        //or nullptr if nothing was published yet
+        const FrameSnapshot* wait_drained()
+        {
+            uint64_t p = produced.load(std::memory_order_relaxed);
+            for (uint64_t c = consumed.load(std::memory_order_acquire); c != p; c = consumed.load(std::memory_order_acquire))
+                consumed.wait(c, std::memory_order_acquire);
+            return p ? &slots[(p - 1) % N] : nullptr;
+        }
+
+        //blocks until a snapshot is published, nullptr once stop() was called
+        FrameSnapshot* begin_read()
+        {
+            uint64_t c = consumed.load(std::memory_order_relaxed);
+            uint64_t p = produced.load(std::memory_order_acquire);
+            for (; p == c; p = produced.load(std::memory_order_acquire))
+                produced.wait(p, std::memory_order_acquire);
+            return p & STOPPED ? nullptr : &slots[c % N];
+        }
+        void release()
+        {
+            consumed.fetch_add(1, std::memory_order_release);
+            consumed.notify_one();
+        }
+
+        //called by the producer after its last publish, snapshots not picked up yet are dropped
+        void stop()
+        {
+            produced.fetch_or(STOPPED, std::memory_order_release);
+            produced.notify_one();
+        }
+
+      private:
+        static constexpr uint64_t STOPPED = 1ull << 63;
+
+        FrameSnapshot         slots[N];
+        std::atomic<uint64_t> produced = 0;
+        std::atomic<uint64_t> consumed = 0;
+    };
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "gpu_profiler.hpp"
+
+using namespace vkengine;
+
+namespace {
+    //the frame's own pair of timestamps follows the passes'
+    constexpr uint32_t FRAME_QUERY = GpuFrameProfile::MAX_PASSES * 2;
+}
+
+double GpuFrameProfile::total_ms() const
+{
+    double ms = 0;
+    for (uint32_t i = 0; i < count; i++)
+        ms += passes[i].ms;
+    return ms;
+}
+
+void GpuProfiler::init(uint32_t computeFamily)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(spock::ctx.physicalDevice, &properties);
+    period = properties.limits.timestampPeriod;
+
+    //dedicated compute families don't have to support timestamps at all
+    if (computeFamily != UINT32_MAX)
+    {
+        uint32_t count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(spock::ctx.physicalDevice, &count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(count);
+        vkGetPhysicalDeviceQueueFamilyProperties(spock::ctx.physicalDevice, &count, families.data());
+        computeTimers = computeFamily < count && families[computeFamily].timestampValidBits > 0;
+    }
+
+    for (Slot& slot : slots)
+    {
+        VkQueryPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        poolInfo.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount            = FRAME_QUERY + 2;
+        VK_CHECK(vkCreateQueryPool(spock::ctx.device, &poolInfo, nullptr, &slot.timestamps));
+    }
+}
+
+void GpuProfiler::destroy()
+{
+    for (Slot& slot : slots)
+    {
+        vkDestroyQueryPool(spock::ctx.device, slot.timestamps, nullptr);
+        slot = {};
+    }
+}
+
+void GpuProfiler::begin_frame(VkCommandBuffer cmd, uint32_t slotIndex, uint64_t frame, bool enabled)
+{
+    Slot& slot = slots[slotIndex];
+    if (slot.frameTimed)
+    {
+        uint64_t timestamps[2][2];
+        vkGetQueryPoolResults(spock::ctx.device, slot.timestamps, FRAME_QUERY, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (timestamps[0][1] && timestamps[1][1])
+            frameMs = double(timestamps[1][0] - timestamps[0][0]) * period / 1e6;
+    }
+    if (slot.profile.count > 0)
+    {
+        //value and availability per query, a pass whose queries are not available is dropped
+        uint64_t timestamps[GpuFrameProfile::MAX_PASSES * 2][2];
+        vkGetQueryPoolResults(spock::ctx.device, slot.timestamps, 0, slot.profile.count * 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        GpuFrameProfile result = {.frame = slot.profile.frame};
+        for (uint32_t i = 0; i < slot.profile.count; i++)
+        {
+            GpuPassTiming pass = slot.profile.passes[i];
+            if (!timestamps[i * 2][1] || !timestamps[i * 2 + 1][1])
+                continue;
+            pass.ms = double(timestamps[i * 2 + 1][0] - timestamps[i * 2][0]) * period / 1e6;
+            result.passes[result.count++] = pass;
+        }
+        //slots left over from a larger frames in flight count hold older frames
+        if (result.count > 0 && (lastFrame.count == 0 || result.frame > lastFrame.frame))
+            lastFrame = result;
+    }
+
+    slot.profile    = {.frame = frame};
+    slot.frameTimed = true;
+    current         = enabled ? &slot : nullptr;
+    frameSlot       = &slot;
+
+    vkCmdResetQueryPool(cmd, slot.timestamps, FRAME_QUERY, 2);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, slot.timestamps, FRAME_QUERY);
+}
+
+void GpuProfiler::end_frame(VkCommandBuffer cmd)
+{
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, frameSlot->timestamps, FRAME_QUERY + 1);
+}
+
+void GpuProfiler::begin_pass(VkCommandBuffer cmd, const char* name, bool async)
+{
+    currentPass = UINT32_MAX;
+    if (!current || current->profile.count == GpuFrameProfile::MAX_PASSES || (async && !computeTimers))
+        return;
+
+    currentPass         = current->profile.count++;
+    GpuPassTiming& pass = current->profile.passes[currentPass];
+    pass                = {.name = name, .async = async};
+
+    //reset in the command buffer of the pass, the compute queue runs ahead of the graphics one
+    vkCmdResetQueryPool(cmd, current->timestamps, currentPass * 2, 2);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, current->timestamps, currentPass * 2);
+}
+
+void GpuProfiler::end_pass(VkCommandBuffer cmd)
+{
+    if (currentPass == UINT32_MAX)
+        return;
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, current->timestamps, currentPass * 2 + 1);
+    currentPass = UINT32_MAX;
+}
+
+void GpuProfileHistory::push(const GpuFrameProfile& frame)
+{
+    if (frame.count == 0 || frame.frame == lastFrame)
+        return;
+    lastFrame    = frame.frame;
+    frames[head] = frame;
+    head         = (head + 1) % SIZE;
+    count        = count < SIZE ? count + 1 : SIZE;
+}
+
+void GpuProfileHistory::pass_ms(const char* name, float* out) const
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const GpuFrameProfile& frame = at(i);
+        out[i]                       = 0;
+        for (uint32_t p = 0; p < frame.count; p++)
+            if (!strcmp(frame.passes[p].name, name))
+                out[i] = frame.passes[p].ms;
+    }
+}
+
+bool GpuProfileHistory::write_csv(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "frame,pass,queue,ms\n");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const GpuFrameProfile& frame = at(i);
+        for (uint32_t p = 0; p < frame.count; p++)
+        {
+            const GpuPassTiming& pass = frame.passes[p];
+            fprintf(file, "%llu,%s,%s,%.4f\n", (unsigned long long)frame.frame, pass.name, pass.async ? "compute" : "graphics", pass.ms);
+        }
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+//GPU frame and per pass timings.
+//Every frame's graphics work is bracketed by a pair of timestamps, and the render graph brackets every
+//pass it executes with another pair, in a query pool owned by the frame slot. A slot's results are
+//read once its fence has been waited on, so they arrive as many frames late as there are frames in
+//flight and reading them never stalls. Passes moved to the async compute queue are timed on that
+//queue.
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+#include "present.hpp"
+
+namespace vkengine {
+    struct GpuPassTiming {
+        const char* name  = nullptr;
+        double      ms    = 0;
+        bool        async = false;
+    };
+
+    struct GpuFrameProfile {
+        static constexpr uint32_t MAX_PASSES = 16;
+
+        //frameIdx the passes were recorded in, count stays 0 until the first results come back
+        uint64_t      frame = 0;
+        uint32_t      count = 0;
+        GpuPassTiming passes[MAX_PASSES];
+
+        double        total_ms() const;
+    };
+
+    struct GpuProfiler {
+        //graphics work of the last frame whose results came back, always measured
+        double frameMs = 0;
+
+        //computeFamily is the async compute family, UINT32_MAX if there is none
+        void init(uint32_t computeFamily);
+        void destroy();
+
+        //call once the slot's graphics and compute work finished, picks up the slot's previous results
+        //and starts timing the frame in cmd. enabled only affects the passes
+        void begin_frame(VkCommandBuffer cmd, uint32_t slot, uint64_t frame, bool enabled);
+        void end_frame(VkCommandBuffer cmd);
+        void begin_pass(VkCommandBuffer cmd, const char* name, bool async);
+        void end_pass(VkCommandBuffer cmd);
+
+        //newest frame whose results came back
+        const GpuFrameProfile& last() const { return lastFrame; }
+
+      private:
+        struct Slot {
+            VkQueryPool     timestamps = VK_NULL_HANDLE;
+            //what the results written into the pool belong to
+            GpuFrameProfile profile;
+            bool            frameTimed = false;
+        };
+
+        Slot            slots[MAX_FRAMES_IN_FLIGHT];
+        GpuFrameProfile lastFrame;
+        Slot*           current       = nullptr;
+        Slot*           frameSlot     = nullptr;
+        uint32_t        currentPass   = UINT32_MAX;
+        bool            computeTimers = false;
+        double          period        = 0;
+    };
+
+    //the last SIZE frames that came back, for the graphs and the csv export
+    struct GpuProfileHistory {
+        static constexpr uint32_t SIZE = 240;
+
+        //ignores frames without results and frames already pushed
+        void push(const GpuFrameProfile& frame);
+        //ms of the pass called name in every frame, oldest first, 0 where the frame didn't run it.
+        //out needs room for size() values
+        void pass_ms(const char* name, float* out) const;
+        bool write_csv(const char* path) const;
+
+        //oldest first
+        const GpuFrameProfile& at(uint32_t i) const { return frames[(head + SIZE - count + i) % SIZE]; }
+        uint32_t               size() const { return count; }
+
+      private:
+        GpuFrameProfile frames[SIZE];
+        uint32_t        head      = 0;
+        uint32_t        count     = 0;
+        uint64_t        lastFrame = UINT64_MAX;
+    };
+}
@@ -12,9 +12,11 @@ GLFWkeyfun              prevCallbackKey;
 GLFWcharfun             prevCallbackChar;
 GLFWmonitorfun          prevCallbackMonitor;
 GLFWframebuffersizefun  prevCallbackFramebufferSize;
+GLFWwindowrefreshfun    prevCallbackWindowRefresh;
 
 void cursor_pos_callback(GLFWwindow* window, double xpos, double ypos) {
     if (prevCallbackCursorPos) prevCallbackCursorPos(window, xpos, ypos);
+    input.events++;
 
     if (!input.firstMouse)
         input.firstMouse = true;
@@ -27,6 +29,7 @@ void cursor_pos_callback(GLFWwindow* window, double xpos, double ypos) {
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     if (prevCallbackMousebutton) prevCallbackMousebutton(window, button, action, mods);
+    input.events++;
     input.mods = mods;
     if (action == GLFW_RELEASE) input.mouseStates[button] = KEY_Off;
     else if (input.mouseStates[button] == KEY_Off) input.mouseStates[button] = KEY_Press;
@@ -34,16 +37,54 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (prevCallbackKey) prevCallbackKey(window, key, scancode, action, mods);
+    input.events++;
     input.mods = mods;
     if (action == GLFW_RELEASE) input.keyStates[key] = KEY_Off;
     else if (input.keyStates[key] == KEY_Off) input.keyStates[key] = KEY_Press;
 }
 
+//events the engine has no use for still change what ImGui or the window shows
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    if (prevCallbackScroll) prevCallbackScroll(window, xoffset, yoffset);
+    input.events++;
+}
+
+void char_callback(GLFWwindow* window, unsigned int c) {
+    if (prevCallbackChar) prevCallbackChar(window, c);
+    input.events++;
+}
+
+void window_focus_callback(GLFWwindow* window, int focused) {
+    if (prevCallbackWindowFocus) prevCallbackWindowFocus(window, focused);
+    input.events++;
+}
+
+void cursor_enter_callback(GLFWwindow* window, int entered) {
+    if (prevCallbackCursorEnter) prevCallbackCursorEnter(window, entered);
+    input.events++;
+}
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    if (prevCallbackFramebufferSize) prevCallbackFramebufferSize(window, width, height);
+    input.events++;
+}
+
+void window_refresh_callback(GLFWwindow* window) {
+    if (prevCallbackWindowRefresh) prevCallbackWindowRefresh(window);
+    input.events++;
+}
+
 void vkengine::init_input_callbacks()
 {
     prevCallbackKey = glfwSetKeyCallback(spock::ctx.window, key_callback);
     prevCallbackMousebutton = glfwSetMouseButtonCallback(spock::ctx.window, mouse_button_callback);
     prevCallbackCursorPos = glfwSetCursorPosCallback(spock::ctx.window, cursor_pos_callback);
+    prevCallbackScroll = glfwSetScrollCallback(spock::ctx.window, scroll_callback);
+    prevCallbackChar = glfwSetCharCallback(spock::ctx.window, char_callback);
+    prevCallbackWindowFocus = glfwSetWindowFocusCallback(spock::ctx.window, window_focus_callback);
+    prevCallbackCursorEnter = glfwSetCursorEnterCallback(spock::ctx.window, cursor_enter_callback);
+    prevCallbackFramebufferSize = glfwSetFramebufferSizeCallback(spock::ctx.window, framebuffer_size_callback);
+    prevCallbackWindowRefresh = glfwSetWindowRefreshCallback(spock::ctx.window, window_refresh_callback);
 }
 
 void vkengine::update_input()
@@ -22,6 +22,8 @@ namespace vkengine {
         float lastY;
         glm::dvec2 mouseRelativeMotion;
         bool firstMouse = false;
+        //bumped by every window event, so the render loop can tell when nothing happened
+        uint32_t events = 0;
         InputData() { memset(keyStates, KEY_Off, sizeof(int)*(GLFW_KEY_LAST+1));
                       memset(mouseStates, KEY_Off, sizeof(int)*(GLFW_MOUSE_BUTTON_LAST+1)); }
     } input;
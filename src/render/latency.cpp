@@ -0,0 +1,37 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "lib/pacer.hpp"
+#include "latency.hpp"
+
+using namespace vkengine;
+
+void LatencyController::update(const FrameLatency& frame, double refreshMs, VkPresentModeKHR mode)
+{
+    //quick to react when frames get more expensive, slow to trust that they got cheaper
+    auto smooth = [](double& value, double sample) { value = sample > value ? sample : value * 0.9 + sample * 0.1; };
+    smooth(cpuMs, frame.cpuMs);
+    smooth(gpuMs, frame.gpuMs);
+
+    //fifo waits for the next vblank and then scans out, the others only scan out
+    double displayMs = mode == VK_PRESENT_MODE_FIFO_KHR || mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR ? refreshMs : refreshMs * 0.5;
+    estimateMs       = frame.inputMs + (frame.queued + 1) * gpuMs + displayMs;
+}
+
+void LatencyController::delay_frame_start(const FrameLatency& last, double marginMs)
+{
+    delayMs = 0;
+    if (last.submitTime == std::chrono::steady_clock::time_point())
+        return;
+
+    //the GPU is busy with the last frame until about submit + gpu time, the next frame needs cpu time to get there
+    auto now    = std::chrono::steady_clock::now();
+    auto target = last.submitTime + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double, std::milli>(gpuMs - cpuMs - marginMs));
+    if (target <= now)
+        return;
+
+    //never hold a frame back longer than the GPU takes for one, a bad estimate costs at most a frame
+    target  = std::min(target, now + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double, std::milli>(gpuMs)));
+    delayMs = std::chrono::duration<double, std::milli>(target - now).count();
+    FramePacer::sleep_until(target);
+}
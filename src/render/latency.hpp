@@ -0,0 +1,35 @@
+#pragma once
+//Low latency frame scheduling.
+//LatencyController runs on the main thread: with the render thread drained it delays the start of the
+//next frame so its CPU work ends about when the GPU runs out of work, instead of queueing frames that
+//then sit behind each other. The GPU cost of a frame comes from GpuProfiler's frame timestamps.
+#include <chrono>
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+#include "present.hpp"
+
+namespace vkengine {
+    //timings of a finished frame, filled in by the render thread
+    struct FrameLatency {
+        std::chrono::steady_clock::time_point submitTime;
+        //from the start of the frame on the main thread, and from the last input sample, to the submit
+        double                                cpuMs   = 0;
+        double                                inputMs = 0;
+        double                                gpuMs   = 0;
+        //frames still executing on the GPU when this one was submitted
+        uint32_t                              queued  = 0;
+    };
+
+    struct LatencyController {
+        //smoothed frame costs, and the input to photon estimate of the last frame
+        double cpuMs      = 0;
+        double gpuMs      = 0;
+        double estimateMs = 0;
+        double delayMs    = 0;
+
+        //refreshMs is the display's refresh interval, presentation adds to the latency depending on the mode
+        void update(const FrameLatency& frame, double refreshMs, VkPresentModeKHR mode);
+        //sleeps until the next frame should start, marginMs is kept as slack for variance in the frame
+        void delay_frame_start(const FrameLatency& last, double marginMs);
+    };
+}
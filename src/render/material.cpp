@@ -0,0 +1,78 @@
+#include <cstring>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "material.hpp"
+
+using namespace vkengine;
+
+BindlessHandle MaterialTable::texture(BindlessRegistry& registry, VkSampler sampler, const spock::Image& image)
+{
+    if (image.imageView == VK_NULL_HANDLE)
+        return {};
+
+    auto it = textures.find(image.imageView);
+    if (it != textures.end())
+        return it->second;
+
+    BindlessHandle handle     = registry.add_sampled_image(image.imageView, sampler);
+    textures[image.imageView] = handle;
+    return handle;
+}
+
+uint32_t MaterialTable::add(BindlessRegistry& registry, VkSampler sampler, const spock::Image& diffuse, const spock::Image& normal, const spock::Image& specular,
+                            const glm::vec4& baseColor, uint32_t flags)
+{
+    GPUMaterial    material;
+    BindlessHandle d = texture(registry, sampler, diffuse);
+    BindlessHandle n = texture(registry, sampler, normal);
+    BindlessHandle s = texture(registry, sampler, specular);
+
+    material.diffuse   = d.index();
+    material.normal    = n.index();
+    material.specular  = s.index();
+    material.flags     = flags | (d.valid() ? MATERIAL_Diffuse : 0) | (n.valid() ? MATERIAL_Normal : 0) | (s.valid() ? MATERIAL_Specular : 0) | (baseColor.a < 1.f ? MATERIAL_Blended : 0);
+    material.baseColor = baseColor;
+
+    //GPUMaterial has no padding, so its bytes are a valid key
+    std::string key((const char*)&material, sizeof(GPUMaterial));
+    auto [it, inserted] = lookup.try_emplace(key, uint32_t(materials.size()));
+    if (inserted)
+        materials.push_back(material);
+    return it->second;
+}
+
+void MaterialTable::upload()
+{
+    //the shaders index the table unconditionally, so it is never empty
+    if (materials.empty())
+        materials.push_back(GPUMaterial{});
+
+    const size_t size = materials.size() * sizeof(GPUMaterial);
+    buffer            = spock::create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                             VMA_MEMORY_USAGE_GPU_ONLY);
+
+    VkBufferDeviceAddressInfo deviceAddressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = buffer.buffer};
+    address = vkGetBufferDeviceAddress(spock::ctx.device, &deviceAddressInfo);
+
+    spock::Buffer staging = spock::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+    memcpy(staging.info.pMappedData, materials.data(), size);
+
+    spock::begin_immediate_command();
+    VkBufferCopy copy{0};
+    copy.size = size;
+    vkCmdCopyBuffer(spock::ctx.immCommandBuffer, staging.buffer, buffer.buffer, 1, &copy);
+    spock::end_immediate_command();
+
+    spock::destroy_buffer(staging);
+    spock::destroyQueue.push(buffer);
+}
+
+void MaterialTable::release(BindlessRegistry& registry)
+{
+    for (auto& [view, handle] : textures)
+        registry.remove(handle);
+    textures.clear();
+    lookup.clear();
+    materials.clear();
+    address = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+//Material table.
+//Every unique material lives once in a device local storage buffer, read by the mesh shaders through
+//its device address. Draws only carry the 32 bit id of their material.
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan_core.h>
+#include "spock/types.hpp"
+#include "bindless.hpp"
+
+namespace vkengine {
+    enum MaterialFlags {
+        MATERIAL_Diffuse   = 0b000001,
+        MATERIAL_Normal    = 0b000010,
+        MATERIAL_Specular  = 0b000100,
+        MATERIAL_Blended   = 0b001000,
+        MATERIAL_AlphaTest = 0b010000,
+        MATERIAL_TwoSided  = 0b100000,
+    };
+
+    //matches Material in mesh.vert and mesh.frag (std430)
+    struct GPUMaterial {
+        int32_t   diffuse   = 0;
+        int32_t   normal    = 0;
+        int32_t   specular  = 0;
+        uint32_t  flags     = 0;
+        glm::vec4 baseColor = glm::vec4(1.f);
+    };
+
+    struct MaterialTable {
+        std::vector<GPUMaterial> materials;
+        spock::Buffer            buffer;
+        VkDeviceAddress          address = 0;
+
+        //textures are registered once per image, identical materials share one id.
+        //flags only needs the bits that can't be derived from the textures and colour (alpha test, two sided)
+        uint32_t add(BindlessRegistry& registry, VkSampler sampler, const spock::Image& diffuse, const spock::Image& normal, const spock::Image& specular,
+                     const glm::vec4& baseColor, uint32_t flags = 0);
+
+        const GPUMaterial& operator[](uint32_t id) const { return materials[id]; }
+        uint32_t           size() const { return materials.size(); }
+
+        //copies the table into a device local buffer, call once after importing
+        void upload();
+        //gives the textures back to the registry and empties the table, call before destroying the images.
+        //The buffer belongs to the destroy queue
+        void release(BindlessRegistry& registry);
+
+      private:
+        BindlessHandle texture(BindlessRegistry& registry, VkSampler sampler, const spock::Image& image);
+
+        std::unordered_map<VkImageView, BindlessHandle> textures;
+        std::unordered_map<std::string, uint32_t>       lookup;
+    };
+}
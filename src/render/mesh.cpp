@@ -6,6 +6,8 @@
 #include "spock/core.hpp"
 #include "spock/internal.hpp"
 #include "mesh.hpp"
+#include "material.hpp"
+#include "lib/profiler.hpp"
 
 using namespace vkengine;
 std::unordered_map<std::string, spock::Image> loadedTextures;
@@ -14,8 +16,9 @@ int                                    vertexID  = 0;
 int                                    indicesID = 0;
 
 
-GPUMeshBuffers                         upload_mesh(std::span<uint32_t> indices, std::span<Vertex> vertices)
+GPUMeshBuffers vkengine::upload_mesh(std::span<uint32_t> indices, std::span<Vertex> vertices)
 {
+    PROFILE_ZONE("upload_mesh");
     const size_t   vertexBufferSize = vertices.size() * sizeof(Vertex);
     const size_t   indexBufferSize  = indices.size() * sizeof(uint32_t);
 
@@ -122,11 +125,29 @@ Mesh processMesh(aiMesh* mesh, const aiScene* scene, const std::string& director
 
     Mesh newMesh{};
     newMesh.data = upload_mesh(indices, vertices);
+
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        positions[i] = vertices[i].position;
+    newMesh.bounds   = compute_bounds(positions);
+    newMesh.occluder = build_occluder_lod(positions, indices);
+
     if (mesh->mMaterialIndex >= 0) {
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         newMesh.diffuse      = load_material_texture(material, aiTextureType_DIFFUSE, directory);
         newMesh.specular     = load_material_texture(material, aiTextureType_SPECULAR, directory);
         newMesh.normal       = load_material_texture(material, aiTextureType_NORMALS, directory);
+
+        aiColor3D diffuse(1.f, 1.f, 1.f);
+        float     opacity = 1.f;
+        material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+        material->Get(AI_MATKEY_OPACITY, opacity);
+        newMesh.baseColor = glm::vec4(diffuse.r, diffuse.g, diffuse.b, opacity);
+
+        //an opacity map means cut outs, which are cheaper tested than blended
+        int twoSided = 0;
+        material->Get(AI_MATKEY_TWOSIDED, twoSided);
+        newMesh.flags = (material->GetTextureCount(aiTextureType_OPACITY) > 0 ? MATERIAL_AlphaTest : 0) | (twoSided ? MATERIAL_TwoSided : 0);
     }
 
     return newMesh;
@@ -145,6 +166,7 @@ void processNode(aiNode* node, const aiScene* scene, Model& model, const std::st
 }
 
 Model vkengine::load_gltf_model(const char* filePath) {
+    PROFILE_ZONE("load_gltf_model");
     Assimp::Importer import;
     const aiScene*   scene = import.ReadFile(filePath, aiProcess_Triangulate | aiProcess_GenNormals);
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
@@ -1,8 +1,10 @@
 #pragma once
+#include <span>
 #include <vector>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan_core.h>
 #include "spock/core.hpp"
+#include "occlusion.hpp"
 namespace vkengine {
     struct Vertex {
         glm::vec3 position;
@@ -31,10 +33,20 @@ namespace vkengine {
         spock::Image          diffuse;
         spock::Image          normal;
         spock::Image          specular;
+        //diffuse colour and opacity from the imported material
+        glm::vec4             baseColor = glm::vec4(1.f);
+        //MaterialFlags that come from the imported material rather than its textures
+        uint32_t              flags     = 0;
+        uint32_t              material  = 0;
+
+        Bounds                bounds;
+        OccluderMesh          occluder;
     };
 
     struct Model {
         std::vector<Mesh> meshes;
     };
     Model load_gltf_model(const char* filePath);
+    //copies the mesh into device local buffers through a staging buffer
+    GPUMeshBuffers upload_mesh(std::span<uint32_t> indices, std::span<Vertex> vertices);
 }
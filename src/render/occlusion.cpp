@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include "occlusion.hpp"
+
+//the AVX2 paths are compiled for AVX2 on their own and only taken when the CPU has it, the rest of
+//the build keeps the baseline instruction set
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OCCLUSION_AVX2 1
+#include <immintrin.h>
+#else
+#define OCCLUSION_AVX2 0
+#endif
+
+using namespace vkengine;
+
+namespace {
+    constexpr int WIDTH       = OcclusionBuffer::WIDTH;
+    constexpr int TILE_WIDTH  = OcclusionBuffer::TILE_WIDTH;
+    constexpr int TILE_HEIGHT = OcclusionBuffer::TILE_HEIGHT;
+    constexpr int TILES_X     = OcclusionBuffer::TILES_X;
+    constexpr int TILES_Y     = OcclusionBuffer::TILES_Y;
+
+    //close to the near plane screen positions get arbitrarily large, and converting a float outside
+    //the range of int is undefined. fmin/fmax also turn a NaN into a bound
+    int to_pixel(float v, int last) { return int(std::fmin(std::fmax(v, 0.f), float(last))); }
+
+    //both paths evaluate the edge functions as a*px + (b*py + c) without fma, so they cover exactly the same pixels
+    void fill_scalar(float* depth, int minX, int maxX, int minY, int maxY, const float* a, const float* b, const float* c, float z)
+    {
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float py     = y + 0.5f;
+            const float row[3] = {b[0] * py + c[0], b[1] * py + c[1], b[2] * py + c[2]};
+            float*      pixels = depth + y * WIDTH;
+            for (int x = minX; x <= maxX; x++)
+            {
+                const float px = x + 0.5f;
+                if (a[0] * px + row[0] >= 0 && a[1] * px + row[1] >= 0 && a[2] * px + row[2] >= 0)
+                    pixels[x] = std::min(pixels[x], z);
+            }
+        }
+    }
+
+    void reduce_tiles_scalar(const float* depth, float* tileMax)
+    {
+        for (int ty = 0; ty < TILES_Y; ty++)
+        {
+            for (int tx = 0; tx < TILES_X; tx++)
+            {
+                const float* tile = depth + ty * TILE_HEIGHT * WIDTH + tx * TILE_WIDTH;
+                float        m    = 0.f;
+                for (int r = 0; r < TILE_HEIGHT; r++)
+                    for (int x = 0; x < TILE_WIDTH; x++)
+                        m = std::max(m, tile[r * WIDTH + x]);
+                tileMax[ty * TILES_X + tx] = m;
+            }
+        }
+    }
+
+#if OCCLUSION_AVX2
+    bool has_avx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    //maxX is inside the buffer and minX is register aligned, so whole registers never run past a row
+    __attribute__((target("avx2"))) void fill_avx2(float* depth, int minX, int maxX, int minY, int maxY, const float* a, const float* b, const float* c, float z)
+    {
+        const __m256 lane   = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero   = _mm256_setzero_ps();
+        const __m256 depthZ = _mm256_set1_ps(z);
+        __m256       edgeA[3];
+        for (int e = 0; e < 3; e++)
+            edgeA[e] = _mm256_set1_ps(a[e]);
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float py = y + 0.5f;
+            __m256      row[3];
+            for (int e = 0; e < 3; e++)
+                row[e] = _mm256_set1_ps(b[e] * py + c[e]);
+
+            float* pixels = depth + y * WIDTH;
+            for (int x = minX; x <= maxX; x += TILE_WIDTH)
+            {
+                const __m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), lane);
+                __m256       edge[3];
+                for (int e = 0; e < 3; e++)
+                    edge[e] = _mm256_add_ps(_mm256_mul_ps(edgeA[e], px), row[e]);
+
+                __m256 inside = _mm256_and_ps(_mm256_cmp_ps(edge[0], zero, _CMP_GE_OQ), _mm256_cmp_ps(edge[1], zero, _CMP_GE_OQ));
+                inside        = _mm256_and_ps(inside, _mm256_cmp_ps(edge[2], zero, _CMP_GE_OQ));
+                if (_mm256_movemask_ps(inside))
+                {
+                    __m256 d = _mm256_load_ps(pixels + x);
+                    _mm256_store_ps(pixels + x, _mm256_blendv_ps(d, _mm256_min_ps(d, depthZ), inside));
+                }
+            }
+        }
+    }
+
+    __attribute__((target("avx2"))) void reduce_tiles_avx2(const float* depth, float* tileMax)
+    {
+        for (int ty = 0; ty < TILES_Y; ty++)
+        {
+            for (int tx = 0; tx < TILES_X; tx++)
+            {
+                const float* tile = depth + ty * TILE_HEIGHT * WIDTH + tx * TILE_WIDTH;
+                __m256       m    = _mm256_load_ps(tile);
+                for (int r = 1; r < TILE_HEIGHT; r++)
+                    m = _mm256_max_ps(m, _mm256_load_ps(tile + r * WIDTH));
+
+                __m128 h = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+                h        = _mm_max_ps(h, _mm_movehl_ps(h, h));
+                h        = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+                tileMax[ty * TILES_X + tx] = _mm_cvtss_f32(h);
+            }
+        }
+    }
+#else
+    bool has_avx2() { return false; }
+#endif
+}
+
+Bounds vkengine::compute_bounds(std::span<const glm::vec3> positions)
+{
+    if (positions.empty())
+        return {};
+
+    Bounds bounds = {positions[0], positions[0]};
+    for (const glm::vec3& p : positions)
+    {
+        bounds.min = glm::min(bounds.min, p);
+        bounds.max = glm::max(bounds.max, p);
+    }
+    return bounds;
+}
+
+OccluderMesh vkengine::build_occluder_lod(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, uint32_t targetTriangles)
+{
+    OccluderMesh lod;
+    if (indices.size() / 3 <= targetTriangles)
+    {
+        lod.positions.assign(positions.begin(), positions.end());
+        lod.indices.assign(indices.begin(), indices.end());
+        return lod;
+    }
+
+    //a closed surface through a g^3 grid touches roughly 6g^2 cells, and ends up with about twice as many triangles
+    const int       grid   = std::max(4, int(std::sqrt(targetTriangles / 12.f) + 0.5f));
+    const Bounds    bounds = compute_bounds(positions);
+    const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(FLT_EPSILON));
+
+    std::unordered_map<uint32_t, uint32_t> cellToVertex;
+    std::vector<uint32_t>                  remap(positions.size());
+    std::vector<uint32_t>                  cellCount;
+
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        glm::ivec3 c    = glm::clamp(glm::ivec3((positions[i] - bounds.min) / extent * float(grid)), glm::ivec3(0), glm::ivec3(grid - 1));
+        uint32_t   cell = (c.z * grid + c.y) * grid + c.x;
+
+        auto [it, inserted] = cellToVertex.try_emplace(cell, uint32_t(lod.positions.size()));
+        if (inserted)
+        {
+            lod.positions.push_back(glm::vec3(0.f));
+            cellCount.push_back(0);
+        }
+        //each cell collapses to the average of its vertices
+        lod.positions[it->second] += positions[i];
+        cellCount[it->second]++;
+        remap[i] = it->second;
+    }
+
+    for (size_t i = 0; i < lod.positions.size(); i++)
+        lod.positions[i] /= float(cellCount[i]);
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if (a == b || b == c || c == a)
+            continue;
+        lod.indices.push_back(a);
+        lod.indices.push_back(b);
+        lod.indices.push_back(c);
+    }
+    return lod;
+}
+
+bool OcclusionBuffer::simd_supported()
+{
+    return has_avx2();
+}
+
+void OcclusionBuffer::begin(const glm::mat4& _viewProj)
+{
+    viewProj = _viewProj;
+    stats    = {};
+    std::fill(std::begin(depth), std::end(depth), FLT_MAX);
+    std::fill(std::begin(tileMax), std::end(tileMax), FLT_MAX);
+}
+
+void OcclusionBuffer::rasterize(const OccluderMesh& occluder, const glm::mat4& world)
+{
+    const glm::mat4        mvp = viewProj * world;
+    std::vector<glm::vec4> clip(occluder.positions.size());
+    for (size_t i = 0; i < occluder.positions.size(); i++)
+        clip[i] = mvp * glm::vec4(occluder.positions[i], 1.f);
+
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+        rasterize_triangle(clip[occluder.indices[i]], clip[occluder.indices[i + 1]], clip[occluder.indices[i + 2]]);
+}
+
+void OcclusionBuffer::rasterize_triangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+{
+    //triangles crossing the near plane are skipped rather than clipped, an occluder may only ever be missing
+    if (c0.w < NEAR_W || c1.w < NEAR_W || c2.w < NEAR_W)
+        return;
+
+    //the whole triangle is written at its farthest depth, which keeps the buffer conservative
+    const float z = std::max(c0.w, std::max(c1.w, c2.w));
+
+    auto to_screen = [](const glm::vec4& c) { return glm::vec2((c.x / c.w * 0.5f + 0.5f) * WIDTH, (c.y / c.w * 0.5f + 0.5f) * HEIGHT); };
+    glm::vec2 v0 = to_screen(c0), v1 = to_screen(c1), v2 = to_screen(c2);
+
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::abs(area) < FLT_EPSILON)
+        return;
+    if (area < 0)
+        std::swap(v1, v2);
+
+    float left   = std::floor(std::min(v0.x, std::min(v1.x, v2.x)));
+    float top    = std::floor(std::min(v0.y, std::min(v1.y, v2.y)));
+    float right  = std::ceil(std::max(v0.x, std::max(v1.x, v2.x)));
+    float bottom = std::ceil(std::max(v0.y, std::max(v1.y, v2.y)));
+    if (right < 0 || bottom < 0 || left > WIDTH - 1 || top > HEIGHT - 1)
+        return;
+    int minX = to_pixel(left, WIDTH - 1);
+    int minY = to_pixel(top, HEIGHT - 1);
+    int maxX = to_pixel(right, WIDTH - 1);
+    int maxY = to_pixel(bottom, HEIGHT - 1);
+
+    stats.occluderTriangles++;
+
+    //edge functions in the form a*x + b*y + c, positive inside
+    const glm::vec2* v[3] = {&v0, &v1, &v2};
+    float            a[3], b[3], c[3];
+    for (int e = 0; e < 3; e++)
+    {
+        const glm::vec2& p = *v[e];
+        const glm::vec2& q = *v[(e + 1) % 3];
+        a[e]               = p.y - q.y;
+        b[e]               = q.x - p.x;
+        c[e]               = -(a[e] * p.x + b[e] * p.y);
+    }
+
+    //start on a register aligned column, the lanes outside the triangle are masked off by the edge test
+    minX -= minX % TILE_WIDTH;
+
+#if OCCLUSION_AVX2
+    if (simd)
+    {
+        fill_avx2(depth, minX, maxX, minY, maxY, a, b, c, z);
+        return;
+    }
+#endif
+    fill_scalar(depth, minX, maxX, minY, maxY, a, b, c, z);
+}
+
+void OcclusionBuffer::finish()
+{
+#if OCCLUSION_AVX2
+    if (simd)
+    {
+        reduce_tiles_avx2(depth, tileMax);
+        return;
+    }
+#endif
+    reduce_tiles_scalar(depth, tileMax);
+}
+
+bool OcclusionBuffer::is_visible(const Bounds& bounds, const glm::mat4& world)
+{
+    stats.tested++;
+    const glm::mat4 mvp = viewProj * world;
+
+    float     minW = FLT_MAX;
+    glm::vec2 minS(FLT_MAX), maxS(-FLT_MAX);
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z);
+        glm::vec4 c = mvp * glm::vec4(corner, 1.f);
+        //the box reaches the camera, nothing can be in front of it
+        if (c.w < NEAR_W)
+            return true;
+
+        glm::vec2 s((c.x / c.w * 0.5f + 0.5f) * WIDTH, (c.y / c.w * 0.5f + 0.5f) * HEIGHT);
+        minS = glm::min(minS, s);
+        maxS = glm::max(maxS, s);
+        minW = std::min(minW, c.w);
+    }
+
+    //off screen, leave that to frustum culling
+    if (maxS.x < 0 || maxS.y < 0 || minS.x >= WIDTH || minS.y >= HEIGHT)
+        return true;
+    int x0 = to_pixel(std::floor(minS.x), WIDTH - 1) / TILE_WIDTH;
+    int y0 = to_pixel(std::floor(minS.y), HEIGHT - 1) / TILE_HEIGHT;
+    int x1 = to_pixel(std::ceil(maxS.x), WIDTH - 1) / TILE_WIDTH;
+    int y1 = to_pixel(std::ceil(maxS.y), HEIGHT - 1) / TILE_HEIGHT;
+
+    for (int ty = y0; ty <= y1; ty++)
+        for (int tx = x0; tx <= x1; tx++)
+            if (tileMax[ty * TILES_X + tx] >= minW)
+                return true;
+
+    stats.culled++;
+    return false;
+}
+
+OcclusionBenchmark vkengine::benchmark_occlusion(uint32_t count, uint32_t iterations)
+{
+    namespace stc = std::chrono;
+
+    //fixed seed so runs are comparable, clip space positions a little past the screen edges
+    uint64_t state = 0x9E3779B97F4A7C15;
+    auto     next  = [&]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return float(state % 100000) / 100000.f;
+    };
+
+    OccluderMesh triangles;
+    for (uint32_t i = 0; i < count * 3; i++)
+    {
+        const float w = 1.f + next() * 99.f;
+        triangles.positions.push_back(glm::vec3((next() * 2.4f - 1.2f) * w, (next() * 2.4f - 1.2f) * w, w));
+        triangles.indices.push_back(i);
+    }
+    //z is copied into w so the triangles land at their own depth
+    glm::mat4 toClip(1.f);
+    toClip[2] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+    toClip[3] = glm::vec4(0.f, 0.f, 0.f, 0.f);
+
+    //too big for the stack
+    auto simd   = std::make_unique<OcclusionBuffer>();
+    auto scalar = std::make_unique<OcclusionBuffer>();
+    scalar->simd = false;
+
+    OcclusionBenchmark result = {.triangles = count, .simd = simd->simd};
+    for (uint32_t it = 0; it < iterations; it++)
+    {
+        auto t0 = stc::steady_clock::now();
+        simd->begin(glm::mat4(1.f));
+        simd->rasterize(triangles, toClip);
+        simd->finish();
+        auto t1 = stc::steady_clock::now();
+        scalar->begin(glm::mat4(1.f));
+        scalar->rasterize(triangles, toClip);
+        scalar->finish();
+        auto t2 = stc::steady_clock::now();
+
+        result.simdMs   += stc::duration<double, std::milli>(t1 - t0).count();
+        result.scalarMs += stc::duration<double, std::milli>(t2 - t1).count();
+    }
+    result.simdMs /= iterations;
+    result.scalarMs /= iterations;
+
+    for (int y = 0; y < OcclusionBuffer::HEIGHT; y++)
+        for (int x = 0; x < OcclusionBuffer::WIDTH; x++)
+            result.mismatches += simd->pixel_depth(x, y) != scalar->pixel_depth(x, y);
+    for (int ty = 0; ty < TILES_Y; ty++)
+        for (int tx = 0; tx < TILES_X; tx++)
+            result.mismatches += simd->tile_depth(tx, ty) != scalar->tile_depth(tx, ty);
+    return result;
+}
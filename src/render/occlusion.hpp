@@ -0,0 +1,80 @@
+#pragma once
+//CPU software occlusion culling.
+//Occluders are rasterized into a low resolution depth buffer, which is reduced to a conservative
+//max depth per tile. Candidate AABBs are then tested against the tiles before any draw is recorded.
+//Nothing in here touches vulkan, so it runs the same on a machine without a GPU.
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace vkengine {
+    struct Bounds {
+        glm::vec3 min = glm::vec3(0.f);
+        glm::vec3 max = glm::vec3(0.f);
+    };
+
+    //simplified, position only copy of a mesh used as an occluder
+    struct OccluderMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t>  indices;
+    };
+
+    Bounds       compute_bounds(std::span<const glm::vec3> positions);
+    //vertex clustering decimation, meshes under targetTriangles are returned unchanged
+    OccluderMesh build_occluder_lod(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, uint32_t targetTriangles = 256);
+
+    struct OcclusionBuffer {
+        //8 pixels per row is one AVX2 register, 4 rows per tile
+        static constexpr int TILE_WIDTH  = 8;
+        static constexpr int TILE_HEIGHT = 4;
+        static constexpr int WIDTH       = 320;
+        static constexpr int HEIGHT      = 192;
+        static constexpr int TILES_X     = WIDTH / TILE_WIDTH;
+        static constexpr int TILES_Y     = HEIGHT / TILE_HEIGHT;
+
+        //depth is stored as clip space w (view distance), so it is linear and does not care about the projection's depth range
+        static constexpr float NEAR_W = 1e-3f;
+
+        struct Stats {
+            uint32_t occluderTriangles = 0;
+            uint32_t tested            = 0;
+            uint32_t culled            = 0;
+        } stats;
+
+        //whether this CPU can take the AVX2 paths, checked once at runtime
+        static bool simd_supported();
+        //turning it off takes the scalar reference paths, they produce the same buffer
+        bool        simd = simd_supported();
+
+        //clears the buffer for a new view
+        void begin(const glm::mat4& viewProj);
+        void rasterize(const OccluderMesh& occluder, const glm::mat4& world);
+        //reduces the pixel depths to per tile max depths, must be called before testing
+        void finish();
+        //conservative, only returns false when the box is behind occluders in every tile it covers
+        bool is_visible(const Bounds& bounds, const glm::mat4& world);
+
+        float tile_depth(int tileX, int tileY) const { return tileMax[tileY * TILES_X + tileX]; }
+        float pixel_depth(int x, int y) const { return depth[y * WIDTH + x]; }
+
+      private:
+        void rasterize_triangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+
+        glm::mat4 viewProj = glm::mat4(1.f);
+        alignas(32) float depth[WIDTH * HEIGHT];
+        alignas(32) float tileMax[TILES_X * TILES_Y];
+    };
+
+    struct OcclusionBenchmark {
+        uint32_t triangles = 0;
+        bool     simd      = false;
+        double   simdMs    = 0;
+        double   scalarMs  = 0;
+        //pixels and tiles where the AVX2 result differs from the scalar reference, always 0 unless something broke
+        uint32_t mismatches = 0;
+    };
+    //rasterizes count random triangles with the AVX2 path and with the scalar one and compares the buffers,
+    //the timings are averaged over a few runs. Without AVX2 only the scalar path runs
+    OcclusionBenchmark benchmark_occlusion(uint32_t count = 4096, uint32_t iterations = 16);
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "lib/util.hpp"
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "pipeline_cache.hpp"
+
+using namespace vkengine;
+
+namespace {
+    //prepended to the driver's blob, the driver header has no driver version in it
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t driverVersion;
+        uint64_t dataSize;
+    };
+
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504B56; //VKPC
+
+    bool validate(const FileHeader& file, const std::vector<char>& data)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(spock::ctx.physicalDevice, &properties);
+
+        if (file.magic != PIPELINE_CACHE_MAGIC || file.driverVersion != properties.driverVersion || file.dataSize != data.size())
+            return false;
+        if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+            return false;
+
+        VkPipelineCacheHeaderVersionOne header;
+        memcpy(&header, data.data(), sizeof(header));
+        //headerSize is checked too, a blob whose header claims to run past the data is corrupt
+        return header.headerSize >= sizeof(header) && header.headerSize <= data.size() && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+               memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
+
+VkPipelineCache vkengine::load_pipeline_cache(const char* path)
+{
+    std::vector<char> data;
+    std::ifstream     file(path, std::ios::binary);
+    FileHeader        header = {};
+    if (file && file.read((char*)&header, sizeof(header)) && header.dataSize < (uint64_t(1) << 32))
+    {
+        data.resize(header.dataSize);
+        if (!file.read(data.data(), data.size()) || !validate(header, data))
+        {
+            printf("Discarding pipeline cache %s, it is stale or from another device\n", path);
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    info.initialDataSize           = data.size();
+    info.pInitialData              = data.empty() ? nullptr : data.data();
+
+    VkPipelineCache cache;
+    VK_CHECK(vkCreatePipelineCache(spock::ctx.device, &info, nullptr, &cache));
+    if (!data.empty())
+        printf("Loaded pipeline cache %s (%zu bytes)\n", path, data.size());
+    return cache;
+}
+
+void vkengine::save_pipeline_cache(VkPipelineCache cache, const char* path)
+{
+    size_t size = 0;
+    VK_CHECK(vkGetPipelineCacheData(spock::ctx.device, cache, &size, nullptr));
+    std::vector<char> data(size);
+    VK_CHECK(vkGetPipelineCacheData(spock::ctx.device, cache, &size, data.data()));
+    data.resize(size);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(spock::ctx.physicalDevice, &properties);
+    FileHeader header = {PIPELINE_CACHE_MAGIC, properties.driverVersion, size};
+
+    //write next to the old file and swap, so a crash mid write never leaves a truncated cache behind
+    std::string tmp = std::string(path) + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(data.data(), data.size());
+        if (!file)
+        {
+            printf("Failed to write pipeline cache %s\n", tmp.c_str());
+            return;
+        }
+    }
+    std::error_code err;
+    std::filesystem::rename(tmp, path, err);
+    if (err)
+        printf("Failed to write pipeline cache %s: %s\n", path, err.message().c_str());
+}
@@ -0,0 +1,12 @@
+#pragma once
+//On disk VkPipelineCache.
+//The cache is loaded at startup, handed to every pipeline creation and written back on shutdown, so
+//warm starts skip the driver's shader compilation. Data written by a different device or driver is
+//ignored rather than handed to the driver.
+#include <vulkan/vulkan_core.h>
+
+namespace vkengine {
+    //always returns a usable cache, empty if the file is missing or was written by another device/driver
+    VkPipelineCache load_pipeline_cache(const char* path);
+    void            save_pipeline_cache(VkPipelineCache cache, const char* path);
+}
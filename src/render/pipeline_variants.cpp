@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <cstdlib>
+#include "spock/core.hpp"
+#include "pipeline_variants.hpp"
+
+using namespace vkengine;
+
+PipelineVariant vkengine::material_variant(const GPUMaterial& material)
+{
+    PipelineVariant variant;
+    if (material.flags & MATERIAL_Blended)
+        variant.blend = BLEND_Blended;
+    else if (material.flags & MATERIAL_AlphaTest)
+        variant.blend = BLEND_AlphaTest;
+    variant.cullMode = (material.flags & MATERIAL_TwoSided) ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+    variant.features = material.flags & (MATERIAL_Diffuse | MATERIAL_Normal | MATERIAL_Specular);
+    return variant;
+}
+
+void VariantCache::init(VkPipeline* _slots, uint32_t _capacity, std::vector<const char*> _shaders, Build _build, ShaderWatcher* _watcher)
+{
+    slots    = _slots;
+    capacity = _capacity;
+    shaders  = std::move(_shaders);
+    build    = _build;
+    watcher  = _watcher;
+    ids.clear();
+}
+
+uint32_t VariantCache::reserve(const PipelineVariant& variant, PipelineSource& source)
+{
+    if (ids.size() == capacity)
+    {
+        printf("Out of pipeline slots, %u variants already exist\n", capacity);
+        abort();
+    }
+
+    uint32_t id        = ids.size();
+    ids[variant.key()] = id;
+    slots[id]          = VK_NULL_HANDLE;
+
+    Build build  = this->build;
+    source      = {shaders, [build, variant](const VkShaderModule* modules) { return build(variant, modules); }, &slots[id]};
+    if (watcher)
+        watcher->add(source);
+    return id;
+}
+
+uint32_t VariantCache::get(const PipelineVariant& variant)
+{
+    auto it = ids.find(variant.key());
+    if (it != ids.end())
+        return it->second;
+
+    PipelineSource source;
+    uint32_t       id = reserve(variant, source);
+    build_pipeline(source);
+    lazyBuilds++;
+    return id;
+}
+
+void VariantCache::precompile(std::span<const PipelineVariant> variants, JobPool& pool)
+{
+    for (const PipelineVariant& variant : variants)
+    {
+        if (ids.contains(variant.key()))
+            continue;
+
+        PipelineSource source;
+        reserve(variant, source);
+        pool.submit([source]() { build_pipeline(source); });
+    }
+}
+
+void VariantCache::destroy()
+{
+    for (uint32_t id = 0; id < ids.size(); id++)
+        vkDestroyPipeline(spock::ctx.device, slots[id], nullptr);
+    ids.clear();
+}
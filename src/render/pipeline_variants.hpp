@@ -0,0 +1,70 @@
+#pragma once
+//Mesh pipeline variants.
+//Every material maps to the cheapest pipeline that draws it correctly: blending and depth writes come
+//from its blend mode, back faces are culled unless it is two sided, and the texture paths it does not
+//use are compiled out through specialization constants. Variants are deduplicated by their packed key
+//and get a slot in the draw pipeline table, so the pipeline id in a draw key is the variant id.
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "lib/jobs.hpp"
+#include "material.hpp"
+#include "shader_watch.hpp"
+
+namespace vkengine {
+    enum BlendMode : uint8_t {
+        BLEND_Opaque    = 0,
+        BLEND_AlphaTest = 1,
+        BLEND_Blended   = 2,
+    };
+
+    //meshes are pulled from their buffer address, so there is only the one layout of Vertex for now
+    enum VertexFormat : uint8_t {
+        VERTEX_Standard = 0,
+    };
+
+    struct PipelineVariant {
+        BlendMode    blend    = BLEND_Opaque;
+        uint8_t      cullMode = VK_CULL_MODE_BACK_BIT;
+        VertexFormat vertex   = VERTEX_Standard;
+        //MATERIAL_Diffuse/Normal/Specular, handed to mesh.frag as specialization constant 0
+        uint8_t      features = 0;
+
+        uint32_t key() const { return uint32_t(blend) | uint32_t(cullMode) << 8 | uint32_t(vertex) << 16 | uint32_t(features) << 24; }
+    };
+
+    PipelineVariant material_variant(const GPUMaterial& material);
+
+    struct VariantCache {
+        //builds a pipeline for a variant against the shared layout
+        using Build = VkPipeline (*)(const PipelineVariant& variant, const VkShaderModule* modules);
+
+        uint32_t lazyBuilds = 0;
+
+        //slots is the draw pipeline table, the variants share a layout created by the caller
+        void init(VkPipeline* slots, uint32_t capacity, std::vector<const char*> shaders, Build build, ShaderWatcher* watcher);
+
+        //returns the variant's pipeline id, building it on the calling thread if it does not exist yet
+        uint32_t get(const PipelineVariant& variant);
+        //queues the missing variants on the pool, the ids are valid straight away but the pipelines
+        //are only usable after pool.wait()
+        void     precompile(std::span<const PipelineVariant> variants, JobPool& pool);
+        //the cache owns its pipelines, the jobs that build them only create them
+        void     destroy();
+
+        uint32_t size() const { return ids.size(); }
+
+      private:
+        //reserves a slot and describes how to build it
+        uint32_t reserve(const PipelineVariant& variant, PipelineSource& source);
+
+        VkPipeline*                            slots    = nullptr;
+        uint32_t                               capacity = 0;
+        std::vector<const char*>               shaders;
+        Build                                  build   = nullptr;
+        ShaderWatcher*                         watcher = nullptr;
+        std::unordered_map<uint32_t, uint32_t> ids;
+    };
+}
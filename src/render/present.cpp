@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "lib/profiler.hpp"
+#include "present.hpp"
+
+using namespace vkengine;
+
+//acquire semaphores: one per frame in flight, one for the image acquired ahead and a spare
+static constexpr uint32_t ACQUIRE_SEMAPHORES = MAX_FRAMES_IN_FLIGHT + 2;
+
+void Presenter::init(VkPresentModeKHR _mode, bool _threaded, bool _headless)
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(spock::ctx.physicalDevice, spock::ctx.surface, &count, nullptr);
+    supportedModes.resize(count);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(spock::ctx.physicalDevice, spock::ctx.surface, &count, supportedModes.data());
+
+    for (PresentFrame& frame : frames)
+    {
+        VkCommandPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.flags                   = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex        = spock::ctx.graphicsQueueFamily;
+        VK_CHECK(vkCreateCommandPool(spock::ctx.device, &poolInfo, nullptr, &frame.commandPool));
+
+        VkCommandBufferAllocateInfo allocInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool                 = frame.commandPool;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = 1;
+        VK_CHECK(vkAllocateCommandBuffers(spock::ctx.device, &allocInfo, &frame.commandBuffer));
+
+        VkFenceCreateInfo fenceInfo = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+        VK_CHECK(vkCreateFence(spock::ctx.device, &fenceInfo, nullptr, &frame.renderFence));
+    }
+
+    headless = _headless;
+    if (headless)
+    {
+        create_offscreen_targets();
+        return;
+    }
+
+    mode     = _mode;
+    threaded = _threaded;
+    recreate_swapchain();
+    create_semaphores();
+    if (threaded)
+        start_thread();
+}
+
+void Presenter::destroy()
+{
+    stop_thread();
+    vkDeviceWaitIdle(spock::ctx.device);
+    destroy_semaphores();
+    for (VkSemaphore semaphore : renderSemaphores)
+        vkDestroySemaphore(spock::ctx.device, semaphore, nullptr);
+    renderSemaphores.clear();
+    for (PresentFrame& frame : frames)
+    {
+        vkDestroyFence(spock::ctx.device, frame.renderFence, nullptr);
+        vkDestroyCommandPool(spock::ctx.device, frame.commandPool, nullptr);
+    }
+    //spock destroys whatever views are left in its swapchain at cleanup, these are not its own
+    for (spock::Image& target : targets)
+        spock::destroy_image(target);
+    if (headless)
+    {
+        spock::ctx.swapchain.images.clear();
+        spock::ctx.swapchain.imageViews.clear();
+    }
+    targets.clear();
+}
+
+PresentFrame& Presenter::begin_frame(uint32_t slot)
+{
+    PresentFrame& frame = frames[slot];
+    VK_CHECK(vkWaitForFences(spock::ctx.device, 1, &frame.renderFence, true, 1000000000));
+    //the submit that waited on the semaphore is done, so it can be acquired with again
+    if (frame.swapchainSemaphore)
+    {
+        std::lock_guard lock(mutex);
+        freeSemaphores.push_back(frame.swapchainSemaphore);
+        frame.swapchainSemaphore = VK_NULL_HANDLE;
+        work.notify_one();
+    }
+    return frame;
+}
+
+bool Presenter::busy(uint32_t slot) const
+{
+    return vkGetFenceStatus(spock::ctx.device, frames[slot].renderFence) == VK_NOT_READY;
+}
+
+uint32_t Presenter::acquire(PresentFrame& frame)
+{
+    //the target was last used MAX_FRAMES_IN_FLIGHT frames ago, its frame's fence has been waited on since
+    if (headless)
+    {
+        nextTarget = (nextTarget + 1) % targets.size();
+        return nextTarget;
+    }
+
+    auto     start = std::chrono::steady_clock::now();
+    uint32_t image = UINT32_MAX;
+    while (image == UINT32_MAX)
+    {
+        if (threaded)
+        {
+            std::unique_lock lock(mutex);
+            ready.wait(lock, [&]() { return !acquired.empty() || outOfDate; });
+            if (!acquired.empty())
+            {
+                image                    = acquired.front().image;
+                frame.swapchainSemaphore = acquired.front().semaphore;
+                acquired.pop_front();
+                work.notify_one();
+            }
+        }
+        else
+        {
+            VkSemaphore semaphore;
+            {
+                std::lock_guard lock(mutex);
+                semaphore = freeSemaphores.back();
+                freeSemaphores.pop_back();
+            }
+            VkResult result = vkAcquireNextImageKHR(spock::ctx.device, spock::ctx.swapchain.swapchain, 1000000000, semaphore, nullptr, &image);
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+            {
+                frame.swapchainSemaphore = semaphore;
+                if (result == VK_SUBOPTIMAL_KHR)
+                    mark_out_of_date();
+            }
+            else
+            {
+                {
+                    std::lock_guard lock(mutex);
+                    freeSemaphores.push_back(semaphore);
+                }
+                image = UINT32_MAX;
+                if (result == VK_ERROR_OUT_OF_DATE_KHR)
+                    mark_out_of_date();
+                else
+                    VK_CHECK(result);
+            }
+        }
+
+        //nothing can be acquired from the old swapchain anymore. While minimised there is nothing to
+        //recreate it with either, so check back every so often until the window has a size again
+        if (image == UINT32_MAX)
+        {
+            reconfigure(mode, threaded);
+            if (outOfDate)
+                std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+    }
+    frameStats.acquireMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return image;
+}
+
+void Presenter::submit(const VkSubmitInfo2& submit, VkFence fence)
+{
+    std::lock_guard lock(queueMutex);
+    VK_CHECK(vkQueueSubmit2(spock::ctx.graphicsQueue, 1, &submit, fence));
+}
+
+void Presenter::present(uint32_t image)
+{
+    if (headless)
+    {
+        lastPresented = image;
+        presentedFrames++;
+        return;
+    }
+    if (!threaded)
+    {
+        present_now(image);
+        return;
+    }
+    std::lock_guard lock(mutex);
+    presents.push_back(image);
+    work.notify_one();
+}
+
+bool Presenter::needs_reconfigure(VkPresentModeKHR _mode, bool _threaded) const
+{
+    if (headless)
+        return false;
+    return outOfDate || _mode != mode || _threaded != threaded;
+}
+
+void Presenter::reconfigure(VkPresentModeKHR _mode, bool _threaded)
+{
+    //the present thread finishes every queued present before it parks or exits, it is only
+    //restarted when threading is switched on or off
+    bool keepThread = threaded && _threaded;
+    if (keepThread)
+        park_thread();
+    else
+        stop_thread();
+    vkDeviceWaitIdle(spock::ctx.device);
+
+    mode     = _mode;
+    threaded = _threaded;
+    //acquires made against the old swapchain may never signal, so none of the semaphores are reused
+    destroy_semaphores();
+    bool recreated = recreate_swapchain();
+    create_semaphores();
+    {
+        //stays out of date while minimised, so the present thread doesn't acquire from the old swapchain
+        std::lock_guard lock(mutex);
+        outOfDate = !recreated;
+    }
+    if (recreated)
+        frameStats.recreated++;
+    if (keepThread)
+        unpark_thread();
+    else if (threaded)
+        start_thread();
+}
+
+PresentStats Presenter::stats() const
+{
+    PresentStats s = frameStats;
+    s.presentMs    = presentUs / 1000.0;
+    s.presented    = presentedFrames;
+    return s;
+}
+
+bool Presenter::save_image(const char* path)
+{
+    if (!headless || presentedFrames == 0)
+        return false;
+
+    vkDeviceWaitIdle(spock::ctx.device);
+    VkExtent2D    extent   = spock::ctx.swapchain.extent;
+    spock::Buffer readback = spock::create_buffer(extent.width * extent.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+    spock::begin_immediate_command();
+    VkCommandBuffer cmd = spock::ctx.immCommandBuffer;
+
+    //the frame left the image in final_layout() without making its writes visible to transfers
+    VkImageMemoryBarrier2 toCopy = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    toCopy.srcStageMask          = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    toCopy.srcAccessMask         = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    toCopy.dstStageMask          = VK_PIPELINE_STAGE_2_COPY_BIT;
+    toCopy.dstAccessMask         = VK_ACCESS_2_TRANSFER_READ_BIT;
+    toCopy.oldLayout             = final_layout();
+    toCopy.newLayout             = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toCopy.image                 = targets[lastPresented].image;
+    toCopy.subresourceRange      = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkDependencyInfo dependency        = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency.imageMemoryBarrierCount = 1;
+    dependency.pImageMemoryBarriers    = &toCopy;
+    vkCmdPipelineBarrier2(cmd, &dependency);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent       = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, targets[lastPresented].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+    VkMemoryBarrier2 toHost = {.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                               .srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT,
+                               .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                               .dstStageMask  = VK_PIPELINE_STAGE_2_HOST_BIT,
+                               .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT};
+    dependency              = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &toHost};
+    vkCmdPipelineBarrier2(cmd, &dependency);
+    spock::end_immediate_command();
+
+    //gpu to cpu memory doesn't have to be host coherent
+    VK_CHECK(vmaInvalidateAllocation(spock::ctx.allocator, readback.allocation, 0, VK_WHOLE_SIZE));
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        printf("Failed to open %s for writing\n", path);
+        spock::destroy_buffer(readback);
+        return false;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", extent.width, extent.height);
+    //the targets have the swapchain's format, which is bgra more often than not
+    bool           bgra   = spock::ctx.swapchain.imageFormat == VK_FORMAT_B8G8R8A8_UNORM || spock::ctx.swapchain.imageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+    const uint8_t* pixels = (const uint8_t*)readback.info.pMappedData;
+    for (uint32_t i = 0; i < extent.width * extent.height; i++)
+    {
+        const uint8_t* p      = pixels + i * 4;
+        uint8_t        rgb[3] = {p[bgra ? 2 : 0], p[1], p[bgra ? 0 : 2]};
+        fwrite(rgb, 1, 3, file);
+    }
+    fclose(file);
+    spock::destroy_buffer(readback);
+    return true;
+}
+
+bool Presenter::recreate_swapchain()
+{
+    VkSurfaceCapabilitiesKHR caps;
+    VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(spock::ctx.physicalDevice, spock::ctx.surface, &caps));
+    VkExtent2D extent = caps.currentExtent;
+    if (extent.width == UINT32_MAX)
+        extent = spock::ctx.swapchain.extent;
+    //minimised, keep the old swapchain until there is something to present to
+    if (extent.width == 0 || extent.height == 0)
+        return false;
+
+    uint32_t imageCount = caps.minImageCount + 1;
+    if (caps.maxImageCount)
+        imageCount = std::min(imageCount, caps.maxImageCount);
+
+    VkSwapchainCreateInfoKHR info = {.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+    info.surface                  = spock::ctx.surface;
+    info.minImageCount            = imageCount;
+    info.imageFormat              = spock::ctx.swapchain.imageFormat;
+    info.imageColorSpace          = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    info.imageExtent              = extent;
+    info.imageArrayLayers         = 1;
+    //the frame is blitted into the swapchain image and the UI is drawn on top
+    info.imageUsage               = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    info.imageSharingMode         = VK_SHARING_MODE_EXCLUSIVE;
+    info.preTransform             = caps.currentTransform;
+    info.compositeAlpha           = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    info.presentMode              = mode;
+    info.clipped                  = VK_TRUE;
+    info.oldSwapchain             = spock::ctx.swapchain.swapchain;
+
+    VkSwapchainKHR swapchain;
+    VK_CHECK(vkCreateSwapchainKHR(spock::ctx.device, &info, nullptr, &swapchain));
+
+    for (VkImageView view : spock::ctx.swapchain.imageViews)
+        vkDestroyImageView(spock::ctx.device, view, nullptr);
+    vkDestroySwapchainKHR(spock::ctx.device, spock::ctx.swapchain.swapchain, nullptr);
+    spock::ctx.swapchain.swapchain = swapchain;
+    spock::ctx.swapchain.extent    = extent;
+
+    vkGetSwapchainImagesKHR(spock::ctx.device, swapchain, &imageCount, nullptr);
+    spock::ctx.swapchain.images.resize(imageCount);
+    spock::ctx.swapchain.imageViews.resize(imageCount);
+    vkGetSwapchainImagesKHR(spock::ctx.device, swapchain, &imageCount, spock::ctx.swapchain.images.data());
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        VkImageViewCreateInfo viewInfo = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        viewInfo.image                 = spock::ctx.swapchain.images[i];
+        viewInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format                = spock::ctx.swapchain.imageFormat;
+        viewInfo.subresourceRange      = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        VK_CHECK(vkCreateImageView(spock::ctx.device, &viewInfo, nullptr, &spock::ctx.swapchain.imageViews[i]));
+    }
+
+    //one render semaphore per image, a present may still be waiting on it when the frame slot comes around again
+    VkSemaphoreCreateInfo semaphoreInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    while (renderSemaphores.size() < imageCount)
+        VK_CHECK(vkCreateSemaphore(spock::ctx.device, &semaphoreInfo, nullptr, &renderSemaphores.emplace_back()));
+    return true;
+}
+
+void Presenter::create_offscreen_targets()
+{
+    //nothing is ever presented, spock's swapchain is replaced by images of the same format
+    for (VkImageView view : spock::ctx.swapchain.imageViews)
+        vkDestroyImageView(spock::ctx.device, view, nullptr);
+    vkDestroySwapchainKHR(spock::ctx.device, spock::ctx.swapchain.swapchain, nullptr);
+    spock::ctx.swapchain.swapchain = VK_NULL_HANDLE;
+    spock::ctx.swapchain.extent    = spock::ctx.screenExtent;
+    spock::ctx.swapchain.images.clear();
+    spock::ctx.swapchain.imageViews.clear();
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        spock::Image& target = targets.emplace_back(spock::create_image(spock::ctx.screenExtent, spock::ctx.swapchain.imageFormat,
+                                                                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+        spock::ctx.swapchain.images.push_back(target.image);
+        spock::ctx.swapchain.imageViews.push_back(target.imageView);
+    }
+}
+
+void Presenter::create_semaphores()
+{
+    VkSemaphoreCreateInfo semaphoreInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    for (uint32_t i = 0; i < ACQUIRE_SEMAPHORES; i++)
+        VK_CHECK(vkCreateSemaphore(spock::ctx.device, &semaphoreInfo, nullptr, &freeSemaphores.emplace_back()));
+}
+
+void Presenter::destroy_semaphores()
+{
+    for (PresentFrame& frame : frames)
+    {
+        if (frame.swapchainSemaphore)
+            freeSemaphores.push_back(frame.swapchainSemaphore);
+        frame.swapchainSemaphore = VK_NULL_HANDLE;
+    }
+    for (Acquired& a : acquired)
+        freeSemaphores.push_back(a.semaphore);
+    acquired.clear();
+
+    for (VkSemaphore semaphore : freeSemaphores)
+        vkDestroySemaphore(spock::ctx.device, semaphore, nullptr);
+    freeSemaphores.clear();
+}
+
+void Presenter::start_thread()
+{
+    stop_thread();
+    stopping = false;
+    parking  = false;
+    thread   = std::thread([this]() { present_loop(); });
+}
+
+void Presenter::park_thread()
+{
+    if (!thread.joinable())
+        return;
+    std::unique_lock lock(mutex);
+    parking = true;
+    work.notify_one();
+    ready.wait(lock, [&]() { return parked; });
+}
+
+void Presenter::unpark_thread()
+{
+    {
+        std::lock_guard lock(mutex);
+        parking = false;
+    }
+    work.notify_one();
+}
+
+void Presenter::mark_out_of_date()
+{
+    {
+        std::lock_guard lock(mutex);
+        outOfDate = true;
+    }
+    //the render thread may be waiting for an acquire that the present thread will no longer make
+    ready.notify_all();
+    work.notify_one();
+}
+
+void Presenter::stop_thread()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    work.notify_one();
+    thread.join();
+    //a thread that was parked when it stopped leaves the flag behind
+    parked = false;
+}
+
+void Presenter::present_loop()
+{
+    PROFILE_THREAD_NAME("present");
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        //keep one image acquired ahead, presents always go first so the image they free can be acquired
+        work.wait(lock, [&]() { return stopping || parking || !presents.empty() || (acquired.empty() && !freeSemaphores.empty() && !outOfDate); });
+
+        if (!presents.empty())
+        {
+            uint32_t image = presents.front();
+            presents.pop_front();
+            lock.unlock();
+            present_now(image);
+            lock.lock();
+            continue;
+        }
+        if (stopping)
+            break;
+        //nothing is acquired or presented while the swapchain is being recreated
+        if (parking)
+        {
+            parked = true;
+            ready.notify_all();
+            work.wait(lock, [&]() { return !parking || stopping; });
+            parked = false;
+            continue;
+        }
+
+        VkSemaphore semaphore = freeSemaphores.back();
+        freeSemaphores.pop_back();
+        lock.unlock();
+        //a short timeout so a present queued meanwhile is not stuck behind an acquire that waits for it
+        uint32_t image;
+        VkResult result = vkAcquireNextImageKHR(spock::ctx.device, spock::ctx.swapchain.swapchain, 1000000, semaphore, nullptr, &image);
+        lock.lock();
+
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+        {
+            acquired.push_back({image, semaphore});
+            if (result == VK_SUBOPTIMAL_KHR)
+                outOfDate = true;
+            ready.notify_all();
+            continue;
+        }
+
+        freeSemaphores.push_back(semaphore);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            //wakes the render thread so it can recreate the swapchain
+            outOfDate = true;
+            ready.notify_all();
+        }
+        else if (result != VK_TIMEOUT && result != VK_NOT_READY)
+            VK_CHECK(result);
+    }
+}
+
+void Presenter::present_now(uint32_t image)
+{
+    PROFILE_ZONE("present");
+    VkPresentInfoKHR presentInfo   = {.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+    presentInfo.pSwapchains        = &spock::ctx.swapchain.swapchain;
+    presentInfo.swapchainCount     = 1;
+    presentInfo.pWaitSemaphores    = &renderSemaphores[image];
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pImageIndices      = &image;
+
+    auto     start = std::chrono::steady_clock::now();
+    VkResult result;
+    {
+        std::lock_guard lock(queueMutex);
+        result = vkQueuePresentKHR(spock::ctx.graphicsQueue, &presentInfo);
+    }
+    presentUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    presentedFrames++;
+
+    if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
+        mark_out_of_date();
+    else
+        VK_CHECK(result);
+}
@@ -0,0 +1,123 @@
+#pragma once
+//Swapchain acquire and present.
+//Frames in flight are owned here rather than by spock, so there can be more of them than
+//spock::FRAME_OVERLAP and the count can change at runtime. With the present thread on, acquire and
+//present move off the render thread: the thread keeps one image acquired ahead and presents finished
+//frames in order, so vsync waits inside the driver happen there.
+//Headless, there is no swapchain: frames render into offscreen images that take the swapchain
+//images' place, acquire just hands out the next one and present only counts the frame.
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "spock/types.hpp"
+
+namespace vkengine {
+    //per frame resources everywhere are allocated for this many frames
+    constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+    struct PresentFrame {
+        VkCommandPool   commandPool   = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence         renderFence   = VK_NULL_HANDLE;
+        //signalled by the acquire of the frame's swapchain image, owned by the frame until its fence is waited on
+        VkSemaphore     swapchainSemaphore = VK_NULL_HANDLE;
+    };
+
+    struct PresentStats {
+        //time the render thread waited for a swapchain image
+        double   acquireMs = 0;
+        //duration of the last vkQueuePresentKHR, on whichever thread made it
+        double   presentMs = 0;
+        uint32_t recreated = 0;
+        uint64_t presented = 0;
+    };
+
+    struct Presenter {
+        VkPresentModeKHR              mode     = VK_PRESENT_MODE_FIFO_KHR;
+        bool                          threaded = false;
+        bool                          headless = false;
+        std::vector<VkPresentModeKHR> supportedModes;
+
+        //recreates spock's swapchain with the requested mode, or replaces it with offscreen images when headless
+        void init(VkPresentModeKHR mode, bool threaded, bool headless = false);
+        void destroy();
+
+        //waits until the GPU is done with the previous frame in the slot
+        PresentFrame& begin_frame(uint32_t slot);
+        //the slot's last frame is still executing
+        bool          busy(uint32_t slot) const;
+        //next swapchain image, frame.swapchainSemaphore is signalled once it can be rendered to
+        uint32_t      acquire(PresentFrame& frame);
+        //signalled by the frame's submit, waited on by the present of the image
+        VkSemaphore   render_semaphore(uint32_t image) const { return headless ? VK_NULL_HANDLE : renderSemaphores[image]; }
+        //layout a finished frame is left in
+        VkImageLayout final_layout() const { return headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+        //the graphics queue is shared with the present thread, every submit to it has to go through here
+        void          submit(const VkSubmitInfo2& submit, VkFence fence);
+        void          present(uint32_t image);
+
+        //swapchain is out of date, or the present mode or threading differ from what is running
+        bool          needs_reconfigure(VkPresentModeKHR mode, bool threaded) const;
+        //waits for the GPU and every queued present, then recreates the swapchain
+        void          reconfigure(VkPresentModeKHR mode, bool threaded);
+
+        PresentStats  stats() const;
+        //frames presented since init, headless ones included
+        uint64_t      presented() const { return presentedFrames; }
+        //headless only, waits for the GPU and writes the last presented frame to a binary ppm
+        bool          save_image(const char* path);
+
+      private:
+        struct Acquired {
+            uint32_t    image;
+            VkSemaphore semaphore;
+        };
+
+        //false while the window is minimised, the old swapchain is kept then
+        bool recreate_swapchain();
+        void create_offscreen_targets();
+        void create_semaphores();
+        void destroy_semaphores();
+        void start_thread();
+        void stop_thread();
+        //holds the present thread idle while the swapchain is recreated
+        void park_thread();
+        void unpark_thread();
+        //under the mutex, and wakes whoever waits on an acquire
+        void mark_out_of_date();
+        void present_loop();
+        void present_now(uint32_t image);
+
+        PresentFrame              frames[MAX_FRAMES_IN_FLIGHT];
+        std::vector<VkSemaphore>  renderSemaphores;
+        //acquire semaphores not owned by a frame or a pre-acquired image
+        std::vector<VkSemaphore>  freeSemaphores;
+        std::atomic<bool>         outOfDate = false;
+        PresentStats              frameStats;
+        std::atomic<uint32_t>     presentUs       = 0;
+        std::atomic<uint64_t>     presentedFrames = 0;
+        //headless targets, the last one handed out and the last one presented
+        std::vector<spock::Image> targets;
+        uint32_t                  nextTarget    = 0;
+        uint32_t                  lastPresented = 0;
+
+        //everything below is shared with the present thread and guarded by mutex
+        std::mutex              mutex;
+        std::condition_variable work;
+        std::condition_variable ready;
+        std::deque<Acquired>    acquired;
+        std::deque<uint32_t>    presents;
+        uint32_t                presenting = 0;
+        bool                    stopping   = false;
+        bool                    parking    = false;
+        bool                    parked     = false;
+        std::thread             thread;
+        //vkQueueSubmit and vkQueuePresentKHR on the graphics queue
+        std::mutex              queueMutex;
+    };
+}
@@ -4,13 +4,21 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan_core.h>
+#include <cfloat>
 #include <chrono>
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+#include <span>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 
 #include "lib/util.hpp"
+#include "lib/pacer.hpp"
+#include "lib/profiler.hpp"
+#include <thread>
 #include "texgui.h"
 #include "spock/core.hpp"
 #include "spock/info.hpp"
@@ -20,6 +28,13 @@
 #include "input.hpp"
 #include "mesh.hpp"
 #include "render.hpp"
+#include "render_queue.hpp"
+#include "descriptors.hpp"
+#include "pipeline_cache.hpp"
+#include "shaders.hpp"
+#include "shader_watch.hpp"
+#include "render_graph.hpp"
+#include "scene_gen.hpp"
 
 #include "render_data.hpp"
 
@@ -63,7 +78,7 @@ static void init_imgui() {
     init_info.Device                    = spock::ctx.device;
     init_info.QueueFamily               = spock::ctx.graphicsQueueFamily;
     init_info.Queue                     = spock::ctx.graphicsQueue;
-    init_info.PipelineCache             = VK_NULL_HANDLE;
+    init_info.PipelineCache             = pipelineCache;
     init_info.DescriptorPool            = imguiPool;
     init_info.UseDynamicRendering       = true;
     init_info.MinImageCount             = 3;
@@ -112,7 +127,7 @@ static void init_texgui() {
     init_info.Device                    = spock::ctx.device;
     init_info.QueueFamily               = spock::ctx.graphicsQueueFamily;
     init_info.Queue                     = spock::ctx.graphicsQueue;
-    init_info.PipelineCache             = VK_NULL_HANDLE;
+    init_info.PipelineCache             = pipelineCache;
     init_info.DescriptorPool            = texguiPool;
     init_info.UseDynamicRendering       = true;
     init_info.MinImageCount             = 3;
@@ -132,19 +147,15 @@ static void init_texgui() {
 
 }
 
-static void draw_imgui(VkImageView imageView) {
-    const auto&               frame           = spock::get_frame();
-    const VkCommandBuffer     cmd             = frame.commandBuffer;
+static void draw_imgui(VkCommandBuffer cmd, VkImageView imageView, ImDrawData* drawData) {
     VkRenderingAttachmentInfo colorAttachment = info::color_attachment(imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
     VkRenderingInfo           renderInfo      = info::rendering(spock::ctx.swapchain.extent, &colorAttachment, nullptr);
     vkCmdBeginRendering(cmd, &renderInfo);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+    ImGui_ImplVulkan_RenderDrawData(drawData, cmd);
     vkCmdEndRendering(cmd);
 }
 
-static void draw_texgui(VkImageView imageView, const TexGui::RenderData& rs) {
-    const auto&               frame           = spock::get_frame();
-    const VkCommandBuffer     cmd             = frame.commandBuffer;
+static void draw_texgui(VkCommandBuffer cmd, VkImageView imageView, const TexGui::RenderData& rs) {
     VkRenderingAttachmentInfo colorAttachment = info::color_attachment(imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
     VkRenderingInfo           renderInfo      = info::rendering(spock::ctx.swapchain.extent, &colorAttachment, nullptr);
     vkCmdBeginRendering(cmd, &renderInfo);
@@ -160,13 +171,14 @@ struct {
     double speed = 0.05f;
 
     glm::dvec3 pos = {0, 0, -5};
+    glm::dvec3 prevPos = pos;
     glm::dvec3 front = {0, 0, 1};
     glm::dvec3 up = {0, 1, 0};
     glm::dvec3 right = {1, 0, 0};
 
-    void update()
+    //mouse motion is accumulated per frame, so looking around happens once per rendered frame
+    void look()
     {
-        double msPassed = double(delta.count()) / double(NS_PER_MS);
         right = glm::normalize(glm::cross({0, 1, 0}, front));
         up = glm::cross(front, right);
         if (input.mouseStates[GLFW_MOUSE_BUTTON_2] == KEY_Held)
@@ -185,7 +197,12 @@ struct {
         direction.y = sin(glm::radians(pitch));
         direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
         front = glm::normalize(direction);
+    }
 
+    //one simulation tick of movement
+    void step(double msPassed)
+    {
+        prevPos = pos;
         if (input.keyStates[GLFW_KEY_W] & KEY_PressORHeld) pos += speed * front * msPassed;
         if (input.keyStates[GLFW_KEY_A] & KEY_PressORHeld) pos += speed * right * msPassed;
         if (input.keyStates[GLFW_KEY_S] & KEY_PressORHeld) pos -= speed * front * msPassed;
@@ -194,39 +211,209 @@ struct {
         if (input.keyStates[GLFW_KEY_LEFT_CONTROL] & KEY_PressORHeld) pos -= speed * glm::dvec3{0,1,0} * msPassed;
     }
 
-    glm::mat4 view_matrix()
+    //alpha is how far the render time is between the last two ticks
+    glm::mat4 view_matrix(double alpha)
     {
-        return glm::lookAt(pos, pos + front, up);
+        glm::dvec3 eye = glm::mix(prevPos, pos, alpha);
+        return glm::lookAt(eye, eye + front, up);
     }
 } camera;
 
 static void init_render_targets()
 {
     //initialize main framebuffer
-    color_attachment0 = spock::create_image(spock::ctx.screenExtent, VK_FORMAT_R16G16B16A16_SFLOAT,
+    color_attachment0 = spock::create_image(spock::ctx.screenExtent, COLOR_FORMAT,
                                             VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-    depth_attachment0 = spock::create_image(spock::ctx.screenExtent, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
 
 }
 
 static void destroy_render_targets()
 {
     spock::destroy_image(color_attachment0);
-    spock::destroy_image(depth_attachment0);
 }
-void vkengine::init_engine() {
+
+static void init_record_pools() {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (uint32_t j = 0; j < MAX_RECORD_CHUNKS; j++) {
+            VkCommandPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+            poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex        = spock::ctx.graphicsQueueFamily;
+            VK_CHECK(vkCreateCommandPool(spock::ctx.device, &poolInfo, nullptr, &recordPools[i][j]));
+
+            VkCommandBufferAllocateInfo allocInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            allocInfo.commandPool                 = recordPools[i][j];
+            allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount          = 1;
+            VK_CHECK(vkAllocateCommandBuffers(spock::ctx.device, &allocInfo, &recordBuffers[i][j]));
+        }
+    }
+}
+
+static void destroy_record_pools() {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (uint32_t j = 0; j < MAX_RECORD_CHUNKS; j++)
+            vkDestroyCommandPool(spock::ctx.device, recordPools[i][j], nullptr);
+}
+
+static VkPipeline build_gradient_pipeline(const VkShaderModule* modules) {
+    VkComputePipelineCreateInfo info = {.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    info.stage                       = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_COMPUTE_BIT, .module = modules[0], .pName = "main"};
+    info.layout                      = computePipelineLayout;
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateComputePipelines(spock::ctx.device, pipelineCache, 1, &info, nullptr, &pipeline));
+    return pipeline;
+}
+
+static VkPipelineLayout create_pipeline_layout(std::initializer_list<VkDescriptorSetLayout> sets, VkPushConstantRange pushConstants) {
+    VkPipelineLayoutCreateInfo info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    info.setLayoutCount             = sets.size();
+    info.pSetLayouts                = sets.begin();
+    info.pushConstantRangeCount     = 1;
+    info.pPushConstantRanges        = &pushConstants;
+
+    VkPipelineLayout layout;
+    VK_CHECK(vkCreatePipelineLayout(spock::ctx.device, &info, nullptr, &layout));
+    return layout;
+}
+
+//blending, depth writes and culling come from the variant, and the texture paths it doesn't use are
+//compiled out of mesh.frag through its specialization constants. Every variant shares vertexPipelineLayout.
+//glTF front faces are counter clockwise, and the projection's flipped y keeps them that way on screen
+static VkPipeline build_mesh_pipeline(const PipelineVariant& variant, const VkShaderModule* modules) {
+    const struct {
+        uint32_t features;
+        VkBool32 alphaTest;
+    } constants = {variant.features, variant.blend == BLEND_AlphaTest};
+
+    const VkSpecializationMapEntry entries[] = {
+        {0, offsetof(decltype(constants), features), sizeof(uint32_t)},
+        {1, offsetof(decltype(constants), alphaTest), sizeof(VkBool32)},
+    };
+    const VkSpecializationInfo specialization = {2, entries, sizeof(constants), &constants};
+
+    VkPipelineColorBlendAttachmentState blend = {.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT};
+    if (variant.blend == BLEND_Blended)
+        blend = color_blend({VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA}, {VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO});
+
+    const VkPipelineShaderStageCreateInfo stages[] = {
+        {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = modules[0], .pName = "main"},
+        {.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+         .stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
+         .module              = modules[1],
+         .pName               = "main",
+         .pSpecializationInfo = &specialization},
+    };
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    //vertices are pulled from their buffer address, there is no vertex input
+    VkPipelineVertexInputStateCreateInfo   vertexInput   = {.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO, .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    VkPipelineViewportStateCreateInfo      viewport      = {.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO, .viewportCount = 1, .scissorCount = 1};
+    VkPipelineRasterizationStateCreateInfo rasterization = {.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+                                                            .polygonMode = VK_POLYGON_MODE_FILL,
+                                                            .cullMode    = variant.cullMode,
+                                                            .frontFace   = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+                                                            .lineWidth   = 1.f};
+    VkPipelineMultisampleStateCreateInfo   multisample   = {.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO, .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT, .minSampleShading = 1.f};
+    //blended surfaces are tested against the depth buffer but don't write it
+    VkPipelineDepthStencilStateCreateInfo  depth         = {.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+                                                            .depthTestEnable  = VK_TRUE,
+                                                            .depthWriteEnable = variant.blend != BLEND_Blended,
+                                                            .depthCompareOp   = VK_COMPARE_OP_LESS_OR_EQUAL,
+                                                            .maxDepthBounds   = 1.f};
+    VkPipelineColorBlendStateCreateInfo    colorBlend    = {.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO, .attachmentCount = 1, .pAttachments = &blend};
+    VkPipelineDynamicStateCreateInfo       dynamic       = {.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO, .dynamicStateCount = 2, .pDynamicStates = dynamicStates};
+    VkPipelineRenderingCreateInfo          rendering     = {.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+                                                            .colorAttachmentCount    = 1,
+                                                            .pColorAttachmentFormats = &COLOR_FORMAT,
+                                                            .depthAttachmentFormat   = DEPTH_FORMAT};
+
+    VkGraphicsPipelineCreateInfo info = {.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, .pNext = &rendering};
+    info.stageCount                   = 2;
+    info.pStages                      = stages;
+    info.pVertexInputState            = &vertexInput;
+    info.pInputAssemblyState          = &inputAssembly;
+    info.pViewportState               = &viewport;
+    info.pRasterizationState          = &rasterization;
+    info.pMultisampleState            = &multisample;
+    info.pDepthStencilState           = &depth;
+    info.pColorBlendState             = &colorBlend;
+    info.pDynamicState                = &dynamic;
+    info.layout                       = vertexPipelineLayout;
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(spock::ctx.device, pipelineCache, 1, &info, nullptr, &pipeline));
+    return pipeline;
+}
+
+//every pipeline is built as an independent job that loads its own shader modules. They all share
+//pipelineCache, which is internally synchronised since it is not created with
+//VK_PIPELINE_CACHE_CREATE_EXTERNALLY_SYNCHRONIZED_BIT. Jobs only call vkCreate*Pipelines, the layouts
+//are created here before any job starts and everything is destroyed by cleanup on the main thread, so
+//no job touches spock's destroy queue. Nothing may use the results until workers.wait() has returned.
+static void submit_pipeline_jobs() {
+    computePipelineLayout         = create_pipeline_layout({computeImageDescLayout}, {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants)});
+    const PipelineSource gradient = {{"assets/shaders/gradient.comp"}, build_gradient_pipeline, &computePipeline};
+    workers.submit([=]() { build_pipeline(gradient); });
+    if (SHADER_HOT_RELOAD)
+        shaderWatcher.add(gradient);
+
+    //variants are precompiled once the materials are in and it is known which ones are used
+    vertexPipelineLayout = create_pipeline_layout({uniformDescLayout, samplerDescriptorSetLayout}, {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants)});
+    meshVariants.init(drawPipelines, drawkey::MAX_PIPELINES, {"assets/shaders/mesh.vert", "assets/shaders/mesh.frag"}, build_mesh_pipeline,
+                      SHADER_HOT_RELOAD ? &shaderWatcher : nullptr);
+}
+
+//startup timing breakdown, printed at the end of init_engine and shown in the ImGui window
+static std::vector<std::pair<const char*, double>> startupTimings;
+static GeneratedScene                              generatedScene;
+static std::chrono::steady_clock::time_point       startupMark;
+
+static void startup_step(const char* name) {
+    auto now = std::chrono::steady_clock::now();
+    startupTimings.push_back({name, std::chrono::duration<double, std::milli>(now - startupMark).count()});
+    startupMark = now;
+}
+
+void vkengine::init_engine(const EngineOptions& options) {
+    startupMark        = std::chrono::steady_clock::now();
+    HEADLESS           = options.headless;
+    FRAME_COUNT        = options.frames;
+    READBACK_PATH      = options.readback;
+    CAMERA_PATH_FRAMES = options.cameraPath;
+    RECORD_TIMINGS     = options.recordTimings;
+    if (RECORD_TIMINGS)
+        frameTimings.reserve(FRAME_COUNT);
+    if (HEADLESS) {
+        //a null window needs no display server, its surface is a VK_EXT_headless_surface one.
+        //spock still creates a swapchain for it, the presenter swaps that for offscreen images
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+        printf("Headless mode needs GLFW 3.4 for its null platform, a display is still required\n");
+#endif
+        //nobody is watching, so frames go as fast as they can and never wait for input
+        FPS_UNLIMITED    = true;
+        RENDER_ON_DEMAND = false;
+        PRESENT_THREAD   = false;
+    }
     spock::init();
+    if (HEADLESS)
+        spock::ctx.screenExtent = {options.width, options.height};
+    pipelineCache = load_pipeline_cache(PIPELINE_CACHE_PATH);
     init_render_targets();
+    presenter.init(PRESENT_MODE, PRESENT_THREAD, HEADLESS);
+    asyncCompute.init(DEVICE_QUEUE_PER_FAMILY);
+    gpuProfiler.init(asyncCompute.family);
+    frameGraph.set_queue_families(spock::ctx.graphicsQueueFamily, asyncCompute.family);
+    startup_step("device");
 
     //initialise descriptor allocators
     spock::ctx.descriptorAllocator.set_flags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
     spock::ctx.descriptorAllocator.init(
-        {{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, IMAGE_COUNT}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SAMPLER_COUNT}, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, STORAGE_COUNT}}, 1);
-    for (int i = 0; i < spock::FRAME_OVERLAP; i++) {
-        spock::ctx.frames[i].descriptorAllocator.init(
-            {{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3}, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3}, {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4}},
-            1000);
-    }
+        {{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, IMAGE_COUNT}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SAMPLER_COUNT}, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, STORAGE_COUNT},
+         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}}, 1);
 
     //create default samplers
     VkSamplerCreateInfo sampl = {.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
@@ -243,65 +430,118 @@ void vkengine::init_engine() {
 
     //create descriptor set layouts
     samplerDescriptorSetLayout = spock::create_descriptor_set_layout(
-        {{SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SAMPLER_COUNT}},
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+        {{STORAGE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, STORAGE_COUNT},
+         {SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SAMPLER_COUNT},
+         {IMAGE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, IMAGE_COUNT}},
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+
+    samplerDescriptorSet = allocate_descriptor_set(samplerDescriptorSetLayout);
+    bindless.init(samplerDescriptorSet, {{SAMPLER_BINDING, SAMPLER_COUNT}, {IMAGE_BINDING, IMAGE_COUNT}, {STORAGE_BINDING, STORAGE_COUNT}}, MAX_FRAMES_IN_FLIGHT);
 
-    samplerDescriptorSet = spock::ctx.descriptorAllocator.allocate(samplerDescriptorSetLayout);
+    computeImageDescLayout = spock::create_descriptor_set_layout({{0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}}, VK_SHADER_STAGE_COMPUTE_BIT);
+    uniformDescLayout      = spock::create_descriptor_set_layout({{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}}, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    //pipelines compile on the workers while the main thread carries on with ui and model loading
+    workers.init();
+    submit_pipeline_jobs();
 
     init_input_callbacks();
     init_imgui();
     init_texgui();
-
-    VkShaderModule gradient = spock::create_shader_module("assets/shaders/gradient.comp");
-    computeImageDescLayout  = spock::create_descriptor_set_layout({{0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}}, VK_SHADER_STAGE_COMPUTE_BIT);
-    uniformDescLayout       = spock::create_descriptor_set_layout({{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}}, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
-    computeImageDesc        = spock::ctx.descriptorAllocator.allocate(computeImageDescLayout);
-
-    spock::update_descriptor_sets({{computeImageDesc, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_NULL_HANDLE, color_attachment0.imageView, VK_IMAGE_LAYOUT_GENERAL}}, {});
-
-    {
-        ComputePipelineBuilder builder;
-        computePipeline = builder.set_descriptor_set_layouts({computeImageDescLayout})
-                              .set_shader_module(gradient)
-                              .set_push_constant_ranges({{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants)}})
-                              .build();
-        computePipelineLayout = builder.layout;
+    startup_step("ui");
+
+    computeImageDesc = allocate_descriptor_set(computeImageDescLayout);
+    write_image_descriptor(computeImageDesc, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, color_attachment0.imageView, VK_IMAGE_LAYOUT_GENERAL);
+
+    //the global set always points at the uniform ring, per frame data only changes the dynamic offset
+    uniformRing.init(UNIFORM_RING_FRAME_SIZE, MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    globalDescriptor = allocate_descriptor_set(uniformDescLayout);
+    write_buffer_descriptor(globalDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, uniformRing.buffer.buffer, 0, sizeof(GPUSceneData));
+
+    if (options.scene) {
+        generatedScene = generate_scene(*options.scene);
+        sceneModel     = std::move(generatedScene.model);
+        for (uint32_t i = 0; i < generatedScene.instanceMeshes.size(); i++)
+            instances.push_back({generatedScene.instanceMeshes[i], generatedScene.instanceTransforms[i]});
+    } else {
+        sceneModel = load_gltf_model("assets/meshes/guitar/backpack.obj");
+        for (uint32_t i = 0; i < sceneModel.meshes.size(); i++)
+            instances.push_back({i, glm::mat4(1.0)});
     }
-
-    {
-        GraphicsPipelineBuilder builder;
-        vertexPipeline = builder.set_descriptor_set_layouts({uniformDescLayout, samplerDescriptorSetLayout})
-                             .set_push_constant_ranges({{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants)}})
-                             .set_color_attachments({color_attachment0})
-                             .set_depth_attachment(depth_attachment0)
-                             .set_shader_stages({{VK_SHADER_STAGE_VERTEX_BIT, spock::create_shader_module("assets/shaders/mesh.vert")},
-                                                 {VK_SHADER_STAGE_FRAGMENT_BIT, spock::create_shader_module("assets/shaders/mesh.frag")}})
-                             .set_input_assembly_state(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-                             .set_viewport_state()
-                             .set_rasterization_state(VK_POLYGON_MODE_FILL, 1.f, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
-                             .set_multisample_state() // disabled
-                             .set_depth_state(VK_COMPARE_OP_LESS_OR_EQUAL, true)
-                             .set_color_blend_states({color_blend({VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA}, {VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO})})
-                             .set_dynamic_states({VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR})
-                             .build();
-
-        vertexPipelineLayout = builder.layout;
+    if (instances.size() > drawkey::MAX_DRAWS || instances.size() * sizeof(GPUDrawData) > UNIFORM_RING_FRAME_SIZE / 2) {
+        printf("%zu instances do not fit the draw keys or the uniform ring\n", instances.size());
+        abort();
     }
-
-    guitar = load_gltf_model("assets/meshes/guitar/backpack.obj");
-    for (auto& mesh: guitar.meshes)
+    for (auto& mesh: sceneModel.meshes)
     {
-        create_texture(mesh.diffuse, currentTextureIndex++, samplerDescriptorSet, SAMPLER_BINDING, linearSampler);
-        create_texture(mesh.normal, currentTextureIndex++, samplerDescriptorSet, SAMPLER_BINDING, linearSampler);
-        create_texture(mesh.specular, currentTextureIndex++, samplerDescriptorSet, SAMPLER_BINDING, linearSampler);
+        mesh.material = materialTable.add(bindless, linearSampler, mesh.diffuse, mesh.normal, mesh.specular, mesh.baseColor, mesh.flags);
+    }
+    materialTable.upload();
+
+    std::vector<PipelineVariant> variants;
+    for (uint32_t i = 0; i < materialTable.size(); i++)
+        variants.push_back(material_variant(materialTable[i]));
+    meshVariants.precompile(variants, workers);
+    for (const PipelineVariant& variant : variants)
+        materialPipelines.push_back(meshVariants.get(variant));
+    startup_step("models");
+
+    //pick the biggest instances as occluders, the scale of the transform counts
+    auto volume = [](const Instance& i) {
+        glm::vec3 e = sceneModel.meshes[i.mesh].bounds.max - sceneModel.meshes[i.mesh].bounds.min;
+        return e.x * e.y * e.z * std::abs(glm::determinant(glm::mat3(i.transform)));
+    };
+    occluders.resize(instances.size());
+    std::iota(occluders.begin(), occluders.end(), 0);
+    std::sort(occluders.begin(), occluders.end(), [&](uint32_t a, uint32_t b) { return volume(instances[a]) > volume(instances[b]); });
+    occluders.resize(std::min<size_t>(occluders.size(), OCCLUDER_COUNT));
+
+    //world space bounds of everything, the camera path orbits them
+    sceneBounds = {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+    for (const Instance& instance : instances) {
+        const Bounds& b = sceneModel.meshes[instance.mesh].bounds;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 p     = {corner & 1 ? b.max.x : b.min.x, corner & 2 ? b.max.y : b.min.y, corner & 4 ? b.max.z : b.min.z};
+            glm::vec3 world = instance.transform * glm::vec4(p, 1.f);
+            sceneBounds.min = glm::min(sceneBounds.min, world);
+            sceneBounds.max = glm::max(sceneBounds.max, world);
+        }
     }
 
+    init_record_pools();
+    startup_step("scene");
+
+    workers.wait();
+    if (SHADER_HOT_RELOAD)
+        shaderWatcher.start(SHADER_SOURCE_DIR, "assets/shaders");
+    startup_step("pipelines");
+
+    bindless.flush(spock::ctx.frameIdx);
     spock::clean_init();
+    //setup allocates every persistent set, none of that belongs to a frame
+    reset_descriptor_stats();
+    startup_step("finalize");
+
+    double total = 0;
+    for (auto& [name, ms] : startupTimings)
+        total += ms;
+    printf("Startup took %.1f ms:", total);
+    for (auto& [name, ms] : startupTimings)
+        printf(" %s %.1f ms,", name, ms);
+    printf(" shaders %u prebuilt, %u cache hits (%.1f ms), %u misses (%.1f ms)\n", shaderCacheStats.prebuilt, shaderCacheStats.hits, shaderCacheStats.loadMs, shaderCacheStats.misses, shaderCacheStats.compileMs);
 }
 
 uint32_t swapchainImageIndex = 0;
-static spock::FrameContext* frame = nullptr;
-void draw_background() {
+static PresentFrame* frame = nullptr;
+//cycles through the first FRAMES_IN_FLIGHT present frames
+static uint32_t frameSlot      = 0;
+static uint32_t framesInFlight = FRAMES_IN_FLIGHT;
+//the snapshot the render thread is working on
+static FrameSnapshot* snapshot = nullptr;
+//recorded into by the passes the render graph moves to the async compute queue
+static VkCommandBuffer computeCmd = VK_NULL_HANDLE;
+void draw_background(VkCommandBuffer cmd) {
+    PROFILE_ZONE("draw_background");
     // draw gradient using compute shader
     ComputePushConstants data = {
         glm::vec4(1.0, 1.0, 0.0, 1.0),
@@ -310,64 +550,202 @@ void draw_background() {
         glm::vec4(1.0, 0.0, 0.0, 1.0),
     };
 
-    vkCmdBindPipeline(frame->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
-    vkCmdBindDescriptorSets(frame->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeImageDesc, 0, nullptr);
-    vkCmdPushConstants(frame->commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &data);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeImageDesc, 0, nullptr);
+    vkCmdPushConstants(cmd, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &data);
 
     // execute the compute pipeline dispatch. We are using 16x16 workgroup size so
     // we need to divide by it
-    vkCmdDispatch(frame->commandBuffer, std::ceil(spock::ctx.extent.width / 16.0), std::ceil(spock::ctx.extent.height / 16.0), 1);
+    vkCmdDispatch(cmd, std::ceil(spock::ctx.extent.width / 16.0), std::ceil(spock::ctx.extent.height / 16.0), 1);
 }
 
-void draw_geometry() {
+//state every command buffer recording geometry needs, secondaries do not inherit any of it
+static void bind_geometry_state(VkCommandBuffer cmd, uint32_t sceneOffset) {
+    // set dynamic viewport and scissor
+    spock::set_viewport(cmd, 0, 0, spock::ctx.extent.width, spock::ctx.extent.height);
+    spock::set_scissor(cmd, 0, 0, spock::ctx.extent.width, spock::ctx.extent.height);
 
-    VkRenderingAttachmentInfo colorAttachment = info::color_attachment(color_attachment0.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    VkRenderingAttachmentInfo depthAttachment = info::depth_attachment(depth_attachment0.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vertexPipelineLayout, 0, 1, &globalDescriptor, 1, &sceneOffset);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vertexPipelineLayout, SAMPLER_BINDING, 1, &samplerDescriptorSet, 0, nullptr);
+}
 
-    VkRenderingInfo           renderInfo = info::rendering(spock::ctx.extent, &colorAttachment, &depthAttachment);
-    vkCmdBeginRendering(frame->commandBuffer, &renderInfo);
+//firstDraw is the position of keys[0] in the queue, which is also its slot in the frame's draw data
+static void record_draws(VkCommandBuffer cmd, std::span<const uint64_t> keys, uint32_t firstDraw) {
+    VertexPushConstants push_constants;
+    VkPipeline          boundPipeline    = VK_NULL_HANDLE;
+    VkBuffer            boundIndexBuffer = VK_NULL_HANDLE;
+
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        const uint64_t key      = keys[i];
+        VkPipeline     pipeline = drawPipelines[drawkey::pipeline(key)];
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
 
-    vkCmdBindPipeline(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vertexPipeline);
+        const auto& mesh      = sceneModel.meshes[instances[drawkey::draw(key)].mesh];
+        push_constants.drawId = firstDraw + i;
 
-    // set dynamic viewport and scissor
-    spock::set_viewport(frame->commandBuffer, 0, 0, spock::ctx.extent.width, spock::ctx.extent.height);
-    spock::set_scissor(frame->commandBuffer, 0, 0, spock::ctx.extent.width, spock::ctx.extent.height);
+        vkCmdPushConstants(cmd, vertexPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants), &push_constants);
+        if (mesh.data.indexBuffer.buffer != boundIndexBuffer) {
+            vkCmdBindIndexBuffer(cmd, mesh.data.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+            boundIndexBuffer = mesh.data.indexBuffer.buffer;
+        }
+
+        vkCmdDrawIndexed(cmd, mesh.data.indexCount, 1, mesh.data.startIndex, 0, 0);
+    }
+}
 
-    VkDescriptorSet globalDescriptor = frame->descriptorAllocator.allocate(uniformDescLayout);
+//each chunk of the sorted queue goes to its own secondary command buffer, executed in queue order
+static void record_draws_parallel(uint32_t sceneOffset, uint32_t chunks) {
+    const uint32_t frameIndex = frameSlot;
+    const size_t   drawCount  = snapshot->queue.keys.size();
 
-    write_uniform_buffer_descriptor(globalDescriptor, &sceneData, sizeof(GPUSceneData));
+    VkCommandBufferInheritanceRenderingInfo inheritRendering = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    inheritRendering.colorAttachmentCount                    = 1;
+    inheritRendering.pColorAttachmentFormats                 = &COLOR_FORMAT;
+    inheritRendering.depthAttachmentFormat                   = DEPTH_FORMAT;
+    inheritRendering.rasterizationSamples                    = VK_SAMPLE_COUNT_1_BIT;
 
-    vkCmdBindDescriptorSets(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vertexPipelineLayout, 0, 1, &globalDescriptor, 0, nullptr);
-    vkCmdBindDescriptorSets(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vertexPipelineLayout, SAMPLER_BINDING, 1, &samplerDescriptorSet, 0, nullptr);
+    VkCommandBufferInheritanceInfo inheritInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO, .pNext = &inheritRendering};
 
-    VertexPushConstants push_constants;
+    workers.parallel_for(chunks, [&](uint32_t chunk) {
+        PROFILE_ZONE("record chunk");
+        VkCommandBuffer cmd = recordBuffers[frameIndex][chunk];
+        VK_CHECK(vkResetCommandPool(spock::ctx.device, recordPools[frameIndex][chunk], 0));
+
+        VkCommandBufferBeginInfo beginInfo = info::begin::command_buffer(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+        beginInfo.pInheritanceInfo         = &inheritInfo;
+        VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
 
-    for (const auto& mesh : guitar.meshes) {
-        push_constants.diffuse      = mesh.diffuse.index;
-        push_constants.normal       = mesh.normal.index;
-        push_constants.specular     = mesh.specular.index;
-        push_constants.vertexBuffer = mesh.data.vertexBufferAddress;
-        push_constants.worldMatrix  = glm::mat4(1.0); //#TODO: make this usable
+        size_t first = drawCount * chunk / chunks;
+        size_t last  = drawCount * (chunk + 1) / chunks;
+        bind_geometry_state(cmd, sceneOffset);
+        record_draws(cmd, std::span<const uint64_t>(snapshot->queue.keys).subspan(first, last - first), first);
 
-        vkCmdPushConstants(frame->commandBuffer, vertexPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants), &push_constants);
-        vkCmdBindIndexBuffer(frame->commandBuffer, mesh.data.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        VK_CHECK(vkEndCommandBuffer(cmd));
+    });
+
+    vkCmdExecuteCommands(frame->commandBuffer, chunks, recordBuffers[frameIndex]);
+}
+
+//depth only lives for the geometry pass, the graph hands out its view
+void draw_geometry(VkImageView depthView) {
+    PROFILE_ZONE("draw_geometry");
+
+    VkRenderingAttachmentInfo colorAttachment = info::color_attachment(color_attachment0.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    VkRenderingAttachmentInfo depthAttachment = info::depth_attachment(depthView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+    VkRenderingInfo           renderInfo = info::rendering(spock::ctx.extent, &colorAttachment, &depthAttachment);
+    const RenderQueue&        queue      = snapshot->queue;
+
+    GPUDrawData* draws;
+    uint32_t     drawsOffset = uniformRing.allocate(queue.keys.size() * sizeof(GPUDrawData), (void**)&draws);
+    for (size_t i = 0; i < queue.keys.size(); i++) {
+        const Instance& instance = instances[drawkey::draw(queue.keys[i])];
+        const auto&     mesh     = sceneModel.meshes[instance.mesh];
+        draws[i]                 = {
+            .worldMatrix  = instance.transform,
+            .vertexBuffer = mesh.data.vertexBufferAddress,
+            .materialId   = mesh.material,
+        };
+    }
 
-        vkCmdDrawIndexed(frame->commandBuffer, mesh.data.indexCount, 1, mesh.data.startIndex, 0, 0);
+    sceneData.materials  = materialTable.address;
+    sceneData.draws      = uniformRing.address + drawsOffset;
+    uint32_t sceneOffset = uniformRing.push(sceneData);
+
+    //small queues are cheaper to record inline than to hand out to workers
+    recordChunks = 0;
+    if (snapshot->parallelRecording && queue.keys.size() >= PARALLEL_RECORD_MIN_DRAWS)
+        recordChunks = std::min<uint32_t>({workers.size() + 1, MAX_RECORD_CHUNKS, uint32_t(queue.keys.size() / (PARALLEL_RECORD_MIN_DRAWS / 4))});
+
+    if (recordChunks > 1) {
+        renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        vkCmdBeginRendering(frame->commandBuffer, &renderInfo);
+        record_draws_parallel(sceneOffset, recordChunks);
+    } else {
+        vkCmdBeginRendering(frame->commandBuffer, &renderInfo);
+        bind_geometry_state(frame->commandBuffer, sceneOffset);
+        record_draws(frame->commandBuffer, queue.keys, 0);
     }
     vkCmdEndRendering(frame->commandBuffer);
 }
 
+//fills the cpu occlusion buffer, meshes behind the occluders are left out of the snapshot's draw list
+static void rasterize_occluders(const glm::mat4& viewProj) {
+    occlusionBuffer.begin(viewProj);
+    for (uint32_t i : occluders)
+        occlusionBuffer.rasterize(sceneModel.meshes[instances[i].mesh].occluder, instances[i].transform);
+    occlusionBuffer.finish();
+}
+
+//main thread side of the frame: everything render() needs from the simulation and the scene
+static void build_snapshot(FrameSnapshot& s) {
+    PROFILE_ZONE("build_snapshot");
+    //the swapchain belongs to the render thread, new_frame clamps the extent to it
+    s.extent.width  = spock::ctx.screenExtent.width * spock::ctx.renderScale;
+    s.extent.height = spock::ctx.screenExtent.height * spock::ctx.renderScale;
+
+    s.proj = glm::perspective(glm::radians(70.f), (float)s.extent.width / (float)s.extent.height, 0.1f, 10000.f);
+    s.proj[1][1] *= -1;
+    //the UI was built since the top of the frame, mouse motion that came in meanwhile still makes this frame
+    if (LOW_LATENCY) {
+        glfwPollEvents();
+        s.inputTime = std::chrono::steady_clock::now();
+    }
+    camera.look();
+    s.view = camera.view_matrix(tickAlpha);
+    //the path follows the frame count rather than time, so every run sees the same views
+    static uint64_t pathFrame = 0;
+    if (CAMERA_PATH_FRAMES)
+        s.view = camera_path_view(sceneBounds, double(pathFrame++ % CAMERA_PATH_FRAMES) / CAMERA_PATH_FRAMES);
+    if (OCCLUSION_CULLING)
+        rasterize_occluders(s.proj * s.view);
+
+    s.queue.clear();
+    for (uint32_t i = 0; i < instances.size(); i++) {
+        const Instance& instance = instances[i];
+        const auto&     mesh     = sceneModel.meshes[instance.mesh];
+        if (OCCLUSION_CULLING && !occlusionBuffer.is_visible(mesh.bounds, instance.transform))
+            continue;
+
+        glm::vec3 centre = (mesh.bounds.min + mesh.bounds.max) * 0.5f;
+        float     depth  = -(s.view * instance.transform * glm::vec4(centre, 1.f)).z;
+        DrawPass  pass   = (materialTable[mesh.material].flags & MATERIAL_Blended) ? PASS_Blended : PASS_Opaque;
+        s.queue.push(pass, materialPipelines[mesh.material], mesh.material, depth, i);
+    }
+    s.queue.sort();
+    s.gpuProfile        = GPU_PROFILER;
+    s.parallelRecording = PARALLEL_RECORDING;
+    s.presentMode       = PRESENT_MODE;
+    s.presentThread     = PRESENT_THREAD;
+    s.framesInFlight    = LOW_LATENCY ? 1 : std::clamp<uint32_t>(FRAMES_IN_FLIGHT, 1, MAX_FRAMES_IN_FLIGHT);
+}
+
 static void new_frame() {
-    frame = &spock::get_frame();
-    VK_CHECK(vkWaitForFences(spock::ctx.device, 1, &frame->renderFence, true, 1000000000));
-    frame->destroyQueue.flush();
-    frame->descriptorAllocator.clear_pools();
-    TexGui::newFrame();
+    PROFILE_ZONE("new_frame");
+    //both drain the GPU, so the slots can be renumbered afterwards
+    if (presenter.needs_reconfigure(snapshot->presentMode, snapshot->presentThread)) {
+        presenter.reconfigure(snapshot->presentMode, snapshot->presentThread);
+        frameSlot = 0;
+    }
+    if (snapshot->framesInFlight != framesInFlight) {
+        vkDeviceWaitIdle(spock::ctx.device);
+        framesInFlight = snapshot->framesInFlight;
+        frameSlot      = 0;
+    }
 
-    VK_CHECK(vkAcquireNextImageKHR(spock::ctx.device, spock::ctx.swapchain.swapchain, 1000000000, frame->swapchainSemaphore, nullptr, &swapchainImageIndex));
+    frame = &presenter.begin_frame(frameSlot);
+    uniformRing.begin_frame(frameSlot);
+    bindless.flush(spock::ctx.frameIdx);
+    if (SHADER_HOT_RELOAD)
+        shaderWatcher.apply();
 
-    spock::ctx.extent.width  = std::min(spock::ctx.screenExtent.width, spock::ctx.swapchain.extent.width) * spock::ctx.renderScale;
-    spock::ctx.extent.height = std::min(spock::ctx.screenExtent.height, spock::ctx.swapchain.extent.height) * spock::ctx.renderScale;
+    swapchainImageIndex = presenter.acquire(*frame);
+
+    spock::ctx.extent.width  = std::min(snapshot->extent.width, spock::ctx.swapchain.extent.width);
+    spock::ctx.extent.height = std::min(snapshot->extent.height, spock::ctx.swapchain.extent.height);
 
     VK_CHECK(vkResetFences(spock::ctx.device, 1, &frame->renderFence));
 
@@ -378,56 +756,134 @@ static void new_frame() {
 
 
     VK_CHECK(vkBeginCommandBuffer(frame->commandBuffer, &cmdBeginInfo));
+    computeCmd = asyncCompute.begin_frame(frameSlot);
+    //the slot's compute work is done as well now, so all of its queries are
+    gpuProfiler.begin_frame(frame->commandBuffer, frameSlot, spock::ctx.frameIdx, snapshot->gpuProfile);
 }
 
 static void end_frame() {
+    PROFILE_ZONE("end_frame");
+    gpuProfiler.end_frame(frame->commandBuffer);
     VK_CHECK(vkEndCommandBuffer(frame->commandBuffer));
+    //compute goes first so graphics only stalls at the stages that consume its results
+    bool computeSubmitted = asyncCompute.submit(frameSlot, frameGraph.uses_async());
+
+    //headless frames have nothing to wait for and nobody to signal
+    VkCommandBufferSubmitInfo cmdInfo     = info::submit::command_buffer(frame->commandBuffer);
+    VkSemaphoreSubmitInfo     waitInfos[2];
+    VkSemaphoreSubmitInfo     signalInfos[2];
+    uint32_t                  waitCount   = 0;
+    uint32_t                  signalCount = 0;
+    if (frame->swapchainSemaphore)
+        waitInfos[waitCount++] = info::submit::semaphore(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, frame->swapchainSemaphore);
+    if (VkSemaphore renderSemaphore = presenter.render_semaphore(swapchainImageIndex))
+        signalInfos[signalCount++] = info::submit::semaphore(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, renderSemaphore);
+    if (asyncCompute.enabled) {
+        VkSemaphoreSubmitInfo computeWait = asyncCompute.graphics_wait(frameSlot, computeSubmitted, frameGraph.async_wait_stage());
+        if (computeWait.semaphore)
+            waitInfos[waitCount++] = computeWait;
+        signalInfos[signalCount++] = asyncCompute.graphics_signal(frameSlot);
+    }
 
-    VkCommandBufferSubmitInfo cmdInfo    = info::submit::command_buffer(frame->commandBuffer);
-    VkSemaphoreSubmitInfo     waitInfo   = info::submit::semaphore(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, frame->swapchainSemaphore);
-    VkSemaphoreSubmitInfo     signalInfo = info::submit::semaphore(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, frame->renderSemaphore);
-    VkSubmitInfo2             submit     = info::submit::submit(&cmdInfo, &waitInfo, &signalInfo);
-    VK_CHECK(vkQueueSubmit2(spock::ctx.graphicsQueue, 1, &submit, frame->renderFence));
-
-    VkPresentInfoKHR presentInfo   = {};
-    presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.pNext              = nullptr;
-    presentInfo.pSwapchains        = &spock::ctx.swapchain.swapchain;
-    presentInfo.swapchainCount     = 1;
-    presentInfo.pWaitSemaphores    = &frame->renderSemaphore;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pImageIndices      = &swapchainImageIndex;
-    VK_CHECK(vkQueuePresentKHR(spock::ctx.graphicsQueue, &presentInfo));
+    VkSubmitInfo2 submit            = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submit.waitSemaphoreInfoCount   = waitCount;
+    submit.pWaitSemaphoreInfos      = waitInfos;
+    submit.commandBufferInfoCount   = 1;
+    submit.pCommandBufferInfos      = &cmdInfo;
+    submit.signalSemaphoreInfoCount = signalCount;
+    submit.pSignalSemaphoreInfos    = signalInfos;
+
+    uint32_t queued = 0;
+    for (uint32_t i = 0; i < framesInFlight; i++)
+        queued += i != frameSlot && presenter.busy(i);
+    presenter.submit(submit, frame->renderFence);
+    auto submitTime = std::chrono::steady_clock::now();
+    presenter.present(swapchainImageIndex);
 
     spock::ctx.frameIdx++;
-}
-
-static void render() {
-    spock::image_barrier(frame->commandBuffer, color_attachment0.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-    draw_background();
-
-    spock::image_barrier(frame->commandBuffer, color_attachment0.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    spock::image_barrier(frame->commandBuffer, depth_attachment0.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
-
-    sceneData.proj = glm::perspective(glm::radians(70.f), (float)spock::ctx.extent.width / (float)spock::ctx.extent.height, 0.1f, 10000.f);
-    sceneData.proj[1][1] *= -1;
-    camera.update();
-    sceneData.view = camera.view_matrix();
-    draw_geometry();
+    frameSlot = (frameSlot + 1) % framesInFlight;
+    end_descriptor_frame();
+
+    FrameStats& stats     = snapshot->stats;
+    stats.descriptors     = frameDescriptorStats;
+    stats.bindlessLive[0] = bindless.live(BINDLESS_SampledImage);
+    stats.bindlessLive[1] = bindless.live(BINDLESS_StorageImage);
+    stats.bindlessLive[2] = bindless.live(BINDLESS_StorageBuffer);
+    stats.draws           = snapshot->queue.keys.size();
+    stats.recordChunks    = recordChunks;
+    stats.graph           = frameGraph.stats;
+    stats.present         = presenter.stats();
+    stats.gpuPasses       = gpuProfiler.last();
+    stats.latency         = {
+                .submitTime = submitTime,
+                .cpuMs      = std::chrono::duration<double, std::milli>(submitTime - snapshot->frameStart).count(),
+                .inputMs    = std::chrono::duration<double, std::milli>(submitTime - snapshot->inputTime).count(),
+                .gpuMs      = gpuProfiler.frameMs,
+                .queued     = queued,
+    };
 
-    spock::image_barrier(frame->commandBuffer, color_attachment0.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-    spock::image_barrier(frame->commandBuffer, spock::ctx.swapchain.images[swapchainImageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    static std::chrono::steady_clock::time_point lastSubmit;
+    if (RECORD_TIMINGS)
+        frameTimings.push_back({
+            .intervalMs = lastSubmit == std::chrono::steady_clock::time_point() ? 0 : std::chrono::duration<double, std::milli>(submitTime - lastSubmit).count(),
+            .cpuMs      = stats.latency.cpuMs,
+            .gpuMs      = stats.latency.gpuMs,
+            .draws      = stats.draws,
+        });
+    lastSubmit = submitTime;
+}
 
-    spock::blit(frame->commandBuffer, color_attachment0.image, spock::ctx.swapchain.images[swapchainImageIndex], spock::ctx.extent, spock::ctx.swapchain.extent);
+//runs the simulation at TICK_LIMIT no matter how fast frames are rendered. Whatever is left over in
+//the accumulator becomes tickAlpha, which render() interpolates with. Returns the number of ticks run
+static uint32_t simulate(std::chrono::nanoseconds elapsed) {
+    PROFILE_ZONE("simulate");
+    tick = std::chrono::nanoseconds(NS_PER_SEC / TICK_LIMIT);
+    //after a long stall (breakpoint, window drag) drop the backlog instead of running hundreds of ticks
+    tickAccumulator = std::min(tickAccumulator + elapsed, tick * MAX_TICKS_PER_FRAME);
+
+    uint32_t ticks = 0;
+    while (tickAccumulator >= tick) {
+        camera.step(double(tick.count()) / double(NS_PER_MS));
+        tickAccumulator -= tick;
+        ticks++;
+    }
+    tickAlpha = double(tickAccumulator.count()) / double(tick.count());
+    return ticks;
+}
 
-    spock::image_barrier(frame->commandBuffer, spock::ctx.swapchain.images[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    draw_imgui(spock::ctx.swapchain.imageViews[swapchainImageIndex]);
-    draw_texgui(spock::ctx.swapchain.imageViews[swapchainImageIndex], copy);
-    spock::image_barrier(frame->commandBuffer, spock::ctx.swapchain.images[swapchainImageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+//the frame is rebuilt as a graph every frame, the graph works out every layout transition and
+//hazard between the passes from what they declare
+static void render() {
+    sceneData.proj = snapshot->proj;
+    sceneData.view = snapshot->view;
+
+    VkImage     swapchainImage = spock::ctx.swapchain.images[swapchainImageIndex];
+    VkImageView swapchainView  = spock::ctx.swapchain.imageViews[swapchainImageIndex];
+
+    frameGraph.begin(spock::ctx.frameIdx);
+    RGImage color     = frameGraph.import_image("color", color_attachment0.image, color_attachment0.imageView, VK_IMAGE_ASPECT_COLOR_BIT);
+    RGImage depth     = frameGraph.create_image("depth", spock::ctx.screenExtent, DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    RGImage swapchain = frameGraph.import_image("swapchain", swapchainImage, swapchainView, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                presenter.final_layout());
+
+    frameGraph.add_pass("background", [](VkCommandBuffer cmd) { draw_background(cmd); }).write(color, ACCESS_ComputeWrite, false).async_compute();
+    frameGraph.add_pass("geometry", [=](VkCommandBuffer) { draw_geometry(frameGraph.view(depth)); })
+        .write(color, ACCESS_ColorAttachment)
+        .write(depth, ACCESS_DepthAttachment, false);
+    frameGraph.add_pass("blit", [=](VkCommandBuffer cmd) { spock::blit(cmd, color_attachment0.image, swapchainImage, spock::ctx.extent, spock::ctx.swapchain.extent); })
+        .read(color, ACCESS_TransferSrc)
+        .write(swapchain, ACCESS_TransferDst, false);
+    frameGraph.add_pass("ui", [=](VkCommandBuffer cmd) {
+                  draw_imgui(cmd, swapchainView, snapshot->imgui_draw_data());
+                  draw_texgui(cmd, swapchainView, snapshot->ui);
+              })
+        .write(swapchain, ACCESS_ColorAttachment);
+
+    frameGraph.compile();
+    frameGraph.execute(frame->commandBuffer, computeCmd, &gpuProfiler);
 }
 
-static inline void add_texgui_widgets()
+static inline void add_texgui_widgets(TexGui::RenderData& out)
 {
     data.Base.Window("not bob", 400, 500, 200, 200, TexGui::CENTER_X | TexGui::CENTER_Y);
     auto win = data.Base.Window("bob", 200, 100, 400, 600, TexGui::RESIZABLE);
@@ -466,7 +922,148 @@ static inline void add_texgui_widgets()
             .Image(TexGui::texByName("lollipop"));
     }
 
-    copy.copy(data);
+    out.copy(data);
+}
+
+static const char* present_mode_name(VkPresentModeKHR mode) {
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:      return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:         return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+    default:                               return "other";
+    }
+}
+
+//the last FLAME_WINDOW_MS of profiler zones, a block of rows per thread with one row per nesting depth
+static void draw_flame_view() {
+#if PROFILER_ENABLED
+    static std::vector<CpuProfiler::Event> events;
+    static uint64_t                        windowEnd = 0;
+    static int                             exported  = -1;
+
+    bool paused = profiler.paused;
+    if (ImGui::Checkbox("pause", &paused))
+        profiler.paused = paused;
+    ImGui::SameLine();
+    if (ImGui::Button("export chrome trace"))
+        exported = profiler.write_chrome_trace(TRACE_PATH);
+    if (exported == 1)
+        ImGui::Text("wrote %s, open it in ui.perfetto.dev or chrome://tracing", TRACE_PATH);
+    else if (exported == 0)
+        ImGui::Text("failed to write %s", TRACE_PATH);
+    ImGui::SliderFloat("window ms", &FLAME_WINDOW_MS, 1, 250);
+
+    //nothing is recorded while paused, so the window stays on the last zones from before
+    if (!profiler.paused)
+        windowEnd = profiler.now_ns();
+    const uint64_t windowNs    = uint64_t(FLAME_WINDOW_MS * NS_PER_MS);
+    const uint64_t windowStart = windowEnd > windowNs ? windowEnd - windowNs : 0;
+    events.clear();
+    profiler.collect(events, windowStart);
+    std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) { return a.thread != b.thread ? a.thread < b.thread : a.start < b.start; });
+
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float width     = ImGui::GetContentRegionAvail().x;
+    ImDrawList* drawList  = ImGui::GetWindowDrawList();
+    for (size_t i = 0; i < events.size();) {
+        uint32_t thread = events[i].thread;
+        uint32_t depth  = 0;
+        size_t   last   = i;
+        while (last < events.size() && events[last].thread == thread)
+            depth = std::max(depth, events[last++].depth);
+
+        ImGui::TextUnformatted(profiler.thread_name(thread));
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::Dummy(ImVec2(width, rowHeight * (depth + 1)));
+        for (; i < last; i++) {
+            const CpuProfiler::Event& e = events[i];
+            if (e.start >= windowEnd)
+                continue;
+            float  x0 = origin.x + width * float(double(std::max(e.start, windowStart) - windowStart) / windowNs);
+            float  x1 = origin.x + width * float(double(std::min(e.end, windowEnd) - windowStart) / windowNs);
+            ImVec2 min(x0, origin.y + rowHeight * e.depth);
+            ImVec2 max(std::max(x1, x0 + 1), min.y + rowHeight - 1);
+
+            //same name same colour, zone names are string literals so the pointer will do
+            uint32_t hash = uint32_t(uintptr_t(e.name) * 2654435761u);
+            drawList->AddRectFilled(min, max, ImColor::HSV((hash >> 8 & 255) / 255.f, 0.5f, 0.7f));
+            if (max.x - min.x > 16) {
+                ImVec4 clip(min.x, min.y, max.x, max.y);
+                drawList->AddText(nullptr, 0, ImVec2(min.x + 2, min.y), IM_COL32_WHITE, e.name, nullptr, 0, &clip);
+            }
+            if (ImGui::IsMouseHoveringRect(min, max))
+                ImGui::SetTooltip("%s: %.3f ms", e.name, (e.end - e.start) / double(NS_PER_MS));
+        }
+    }
+#else
+    ImGui::Text("the profiler is compiled out, build with DBG or VKENGINE_PROFILE");
+#endif
+}
+
+//latest per pass gpu timings with a graph of each pass over the last frames that came back
+static void draw_gpu_profile(const GpuFrameProfile& last) {
+    static GpuProfileHistory  history;
+    static std::vector<float> samples;
+    static int                exported = -1;
+    history.push(last);
+
+    ImGui::Checkbox("time passes", &GPU_PROFILER);
+    ImGui::SameLine();
+    if (ImGui::Button("export csv"))
+        exported = history.write_csv(GPU_PROFILE_CSV_PATH);
+    if (exported == 1)
+        ImGui::Text("wrote the last %u frames to %s", history.size(), GPU_PROFILE_CSV_PATH);
+    else if (exported == 0)
+        ImGui::Text("failed to write %s", GPU_PROFILE_CSV_PATH);
+    if (last.count == 0)
+        return;
+
+    samples.resize(history.size());
+    for (uint32_t i = 0; i < history.size(); i++)
+        samples[i] = history.at(i).total_ms();
+    ImGui::Text("frame %llu: %.3f ms in %u passes", (unsigned long long)last.frame, last.total_ms(), last.count);
+    ImGui::PlotLines("##total", samples.data(), samples.size(), 0, nullptr, 0, FLT_MAX, ImVec2(0, 40));
+
+    if (!ImGui::BeginTable("gpu passes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+        return;
+    ImGui::TableSetupColumn("pass");
+    ImGui::TableSetupColumn("queue");
+    ImGui::TableSetupColumn("ms");
+    ImGui::TableSetupColumn("avg ms");
+    ImGui::TableSetupColumn("history", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableHeadersRow();
+    for (uint32_t i = 0; i < last.count; i++) {
+        const GpuPassTiming& pass = last.passes[i];
+        history.pass_ms(pass.name, samples.data());
+        double average = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+
+        ImGui::PushID(i);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(pass.name);
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(pass.async ? "compute" : "graphics");
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", pass.ms);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", average);
+        ImGui::TableNextColumn();
+        ImGui::PlotLines("##history", samples.data(), samples.size(), 0, nullptr, 0, FLT_MAX, ImVec2(-FLT_MIN, 0));
+        ImGui::PopID();
+    }
+    ImGui::EndTable();
+}
+
+//records and submits every snapshot the main thread publishes, until it stops publishing
+static void render_loop() {
+    PROFILE_THREAD_NAME("render");
+    while ((snapshot = snapshots.begin_read())) {
+        new_frame();
+        render();
+        end_frame();
+        snapshots.release();
+    }
 }
 void vkengine::run() {
     using namespace std::chrono_literals;
@@ -476,13 +1073,41 @@ void vkengine::run() {
     uint32_t frameCounter = 0;
     stc::nanoseconds second(0);
     auto lastFrame = stc::steady_clock::now();
-
-    while (!glfwWindowShouldClose(spock::ctx.window)) {
-        //#TODO: tick != fps
-        tick = stc::nanoseconds(NS_PER_SEC / FPS_LIMIT);
+    FramePacer pacer;
+
+    uint32_t   ticks = 0;
+    FrameStats stats;
+    //presentation adds up to a refresh interval to the latency
+    GLFWmonitor*       monitor   = glfwGetPrimaryMonitor();
+    const GLFWvidmode* videoMode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    double             refreshMs = 1000.0 / (videoMode && videoMode->refreshRate ? videoMode->refreshRate : 60);
+    //what the last frame looked like, to tell when nothing changes
+    uint32_t  lastEvents = input.events;
+    glm::mat4 lastView   = glm::mat4(0);
+    uint32_t  idleFrames = 0;
+    uint32_t  idleWaits  = 0;
+    //the main thread only simulates and builds snapshots from here on, the render thread records and presents them
+    std::thread renderThread(render_loop);
+    PROFILE_THREAD_NAME("main");
+
+    uint64_t published = 0;
+    while (!glfwWindowShouldClose(spock::ctx.window) && (!FRAME_COUNT || published < FRAME_COUNT)) {
+        //the last frames are all on screen already, nothing new would be drawn until something happens.
+        //any window event or a posted empty event wakes this up right away
+        bool woke = RENDER_ON_DEMAND && idleFrames >= IDLE_SETTLE_FRAMES;
+        if (woke) {
+            //input that arrives while waiting belongs to the next frame
+            update_input();
+            glfwWaitEventsTimeout(IDLE_TIMEOUT_S);
+            idleWaits++;
+            //the time spent waiting is not simulated or counted as a frame, and not a missed deadline either.
+            //whatever woke us up is drawn straight away
+            lastFrame = stc::steady_clock::now();
+            pacer.reset(lastFrame);
+        }
+        else if (!FPS_UNLIMITED)
+            pacer.wait(stc::nanoseconds(NS_PER_SEC / FPS_LIMIT));
         auto now = stc::steady_clock::now();
-        if (now - lastFrame < tick && !FPS_UNLIMITED)
-            continue;
 
         delta = now - lastFrame;
         second += delta;
@@ -494,8 +1119,24 @@ void vkengine::run() {
         }
         lastFrame = now;
 
-        update_input();
+        //waiting for a free slot before sampling input keeps the snapshot as fresh as possible
+        FrameSnapshot* next = snapshots.begin_write();
+        stats = next->stats;
+        //in low latency mode the frame only starts once the render thread has submitted the last one,
+        //and then as late as the GPU allows
+        if (LOW_LATENCY)
+            if (const FrameSnapshot* last = snapshots.wait_drained())
+                stats = last->stats;
+        latency.update(stats.latency, refreshMs, PRESENT_MODE);
+        if (LOW_LATENCY)
+            latency.delay_frame_start(stats.latency, LOW_LATENCY_MARGIN_MS);
+        next->frameStart = stc::steady_clock::now();
+
+        if (!woke)
+            update_input();
         glfwPollEvents();
+        next->inputTime = stc::steady_clock::now();
+        ticks = simulate(delta);
 
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -505,17 +1146,80 @@ void vkengine::run() {
             ImGui::SliderDouble("camera speed per ms", &camera.speed, 0, 0.1);
             ImGui::SliderInt("max fps", &FPS_LIMIT, 15, 240);
             ImGui::Checkbox("unlimited fps", &FPS_UNLIMITED);
+            if (ImGui::BeginCombo("present mode", present_mode_name(PRESENT_MODE))) {
+                for (VkPresentModeKHR mode : presenter.supportedModes)
+                    if (ImGui::Selectable(present_mode_name(mode), mode == PRESENT_MODE))
+                        PRESENT_MODE = mode;
+                ImGui::EndCombo();
+            }
+            ImGui::Checkbox("present thread", &PRESENT_THREAD);
+            ImGui::Checkbox("render on demand", &RENDER_ON_DEMAND);
+            if (RENDER_ON_DEMAND)
+                ImGui::Text("went idle %u times", idleWaits);
+            ImGui::SliderInt("frames in flight", &FRAMES_IN_FLIGHT, 1, MAX_FRAMES_IN_FLIGHT);
+            ImGui::Text("acquire wait %.2f ms, present %.2f ms, swapchain recreated %u times", stats.present.acquireMs, stats.present.presentMs, stats.present.recreated);
+            ImGui::Checkbox("low latency", &LOW_LATENCY);
+            if (LOW_LATENCY)
+                ImGui::SliderFloat("low latency margin ms", &LOW_LATENCY_MARGIN_MS, 0, 5);
+            ImGui::Text("input to photon ~%.1f ms (cpu %.2f, gpu %.2f ms, delayed %.2f ms, %u queued)", latency.estimateMs, latency.cpuMs, latency.gpuMs,
+                        latency.delayMs, stats.latency.queued);
+            ImGui::SliderInt("simulation tick rate", &TICK_LIMIT, 15, 480);
             ImGui::Text("FPS: %d", fps);
             ImGui::Text("%d ms since last frame", int(delta.count() / NS_PER_MS));
+            ImGui::Text("%u simulation ticks this frame, alpha %.2f", ticks, tickAlpha);
+            if (!FPS_UNLIMITED)
+                ImGui::Text("pacing jitter: p50 %.3f ms, p99 %.3f ms (spin margin %.2f ms)", pacer.jitter(0.5).count() / double(NS_PER_MS),
+                            pacer.jitter(0.99).count() / double(NS_PER_MS), pacer.spinMargin.count() / double(NS_PER_MS));
+            ImGui::Checkbox("occlusion culling", &OCCLUSION_CULLING);
+            ImGui::Text("occluded: %u/%u meshes (%s rasterizer)", occlusionBuffer.stats.culled, occlusionBuffer.stats.tested, occlusionBuffer.simd ? "avx2" : "scalar");
+            ImGui::Text("descriptor sets allocated: %u, written: %u", stats.descriptors.allocations, stats.descriptors.writes);
+            ImGui::Text("bindless slots: %u sampled, %u storage images, %u storage buffers", stats.bindlessLive[0], stats.bindlessLive[1], stats.bindlessLive[2]);
+            ImGui::Checkbox("parallel recording", &PARALLEL_RECORDING);
+            ImGui::Text("%u draws in %u secondary command buffers", stats.draws, stats.recordChunks);
+            ImGui::Text("mesh pipeline variants: %u (%u built lazily)", meshVariants.size(), meshVariants.lazyBuilds);
+            ImGui::Text("render graph: %u passes (%u culled), %u barriers in %u batches", stats.graph.passes, stats.graph.culled, stats.graph.imageBarriers,
+                        stats.graph.barrierBatches);
+            if (asyncCompute.enabled)
+                ImGui::Text("async compute: %u passes on queue family %u", stats.graph.asyncPasses, asyncCompute.family);
+            else
+                ImGui::Text("async compute: no dedicated compute queue");
+            ImGui::Text("transient memory: %.1f MB (%.1f MB without aliasing)", stats.graph.allocatedBytes / 1048576.0, stats.graph.transientBytes / 1048576.0);
+            if (SHADER_HOT_RELOAD)
+                ImGui::Text("shader reloads: %u (%u failed)", shaderWatcher.reloads, shaderWatcher.failures);
+
+            if (ImGui::CollapsingHeader("startup")) {
+                for (auto& [name, ms] : startupTimings)
+                    ImGui::Text("%s: %.1f ms", name, ms);
+                ImGui::Text("shaders: %u prebuilt, %u cache hits, %u misses", shaderCacheStats.prebuilt, shaderCacheStats.hits, shaderCacheStats.misses);
+            }
+
+            if (ImGui::CollapsingHeader("cpu profiler"))
+                draw_flame_view();
+            if (ImGui::CollapsingHeader("gpu passes"))
+                draw_gpu_profile(stats.gpuPasses);
+
+            static SortBenchmark sortBenchmark;
+            if (ImGui::Button("benchmark draw key sort"))
+                sortBenchmark = benchmark_draw_key_sort();
+            if (sortBenchmark.count)
+                ImGui::Text("%u keys: radix %.3f ms, std::sort %.3f ms", sortBenchmark.count, sortBenchmark.radixMs, sortBenchmark.stdSortMs);
         }
         ImGui::End();
 
         ImGui::Render();
-        add_texgui_widgets();
+        TexGui::newFrame();
+        add_texgui_widgets(next->ui);
 
-        new_frame();
-        render();
-        end_frame();
+        build_snapshot(*next);
+        next->capture_imgui(ImGui::GetDrawData());
+        snapshots.publish();
+        published++;
+
+        //held keys and camera interpolation change the view without any new events, text input blinks a cursor
+        bool changed = input.events != lastEvents || next->view != lastView || ImGui::GetIO().WantTextInput;
+        idleFrames   = changed ? 0 : idleFrames + 1;
+        lastEvents   = input.events;
+        lastView     = next->view;
 
         data.clear();
         TexGui::clear();
@@ -525,10 +1229,68 @@ void vkengine::run() {
 
         frameCounter++;
     }
+
+    //every published frame gets rendered, so a fixed frame count is exact
+    snapshots.wait_drained();
+    snapshots.stop();
+    renderThread.join();
+
+    if (READBACK_PATH && !presenter.save_image(READBACK_PATH))
+        printf("Nothing was read back to %s, only headless frames can be\n", READBACK_PATH);
+}
+
+uint64_t vkengine::frames_rendered()
+{
+    return presenter.presented();
+}
+
+const std::vector<FrameTiming>& vkengine::frame_timings()
+{
+    return frameTimings;
+}
+
+MemoryUsage vkengine::memory_usage()
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(spock::ctx.physicalDevice, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(spock::ctx.allocator, budgets);
+
+    MemoryUsage usage = {};
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        usage.blockBytes      += budgets[i].statistics.blockBytes;
+        usage.allocationBytes += budgets[i].statistics.allocationBytes;
+        usage.usage           += budgets[i].usage;
+        usage.budget          += budgets[i].budget;
+    }
+    return usage;
 }
 
 void vkengine::cleanup()
 {
+    shaderWatcher.stop();
+    vkDeviceWaitIdle(spock::ctx.device);
+    shaderWatcher.destroy();
+    presenter.destroy();
+    gpuProfiler.destroy();
+    frameGraph.destroy();
+    asyncCompute.destroy();
+    save_pipeline_cache(pipelineCache, PIPELINE_CACHE_PATH);
+    vkDestroyPipelineCache(spock::ctx.device, pipelineCache, nullptr);
+    workers.shutdown();
+    meshVariants.destroy();
+    vkDestroyPipeline(spock::ctx.device, computePipeline, nullptr);
+    vkDestroyPipelineLayout(spock::ctx.device, vertexPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(spock::ctx.device, computePipelineLayout, nullptr);
+    destroy_record_pools();
     destroy_render_targets();
+    materialTable.release(bindless);
+#ifdef DBG
+    for (uint32_t type = 0; type < BINDLESS_TypeCount; type++)
+        if (bindless.live(BindlessType(type)))
+            printf("Warning: %u bindless slots of type %u were never removed\n", bindless.live(BindlessType(type)), type);
+#endif
+    destroy_generated_textures(generatedScene);
+    shutdown_shader_compiler();
     spock::cleanup();
 }
@@ -1,7 +1,63 @@
 #pragma once
+#include <cstdint>
+#include <vector>
 
 namespace vkengine {
-    void        init_engine();
+    //procedurally generated stand in for the loaded model, the same desc always gives the same scene
+    struct SceneDesc {
+        //unique meshes, and instances of them scattered around the origin
+        uint32_t meshes      = 64;
+        uint32_t instances   = 4096;
+        //generated diffuse textures, shared out between the meshes
+        uint32_t textures    = 16;
+        uint32_t textureSize = 256;
+        uint32_t seed        = 1;
+    };
+
+    struct EngineOptions {
+        //no window system and no swapchain, frames render into offscreen images. Works on any Vulkan
+        //implementation that exposes VK_EXT_headless_surface, lavapipe included
+        bool        headless = false;
+        //resolution of the offscreen images
+        uint32_t    width    = 1280;
+        uint32_t    height   = 720;
+        //run() returns after this many frames, 0 keeps going until the window is closed
+        uint32_t    frames   = 0;
+        //headless only, the last frame is written here as a binary ppm
+        const char* readback = nullptr;
+        //replaces the loaded model when set
+        const SceneDesc* scene = nullptr;
+        //the camera orbits the scene once every cameraPath frames instead of following input, 0 turns it off
+        uint32_t    cameraPath    = 0;
+        //keep the timings of every frame, see frame_timings()
+        bool        recordTimings = false;
+    };
+
+    struct FrameTiming {
+        //time since the previous frame's submit
+        double   intervalMs;
+        //from the start of the frame on the main thread to its submit
+        double   cpuMs;
+        //graphics queue time of the most recent frame whose timestamps came back, a few frames behind
+        double   gpuMs;
+        uint32_t draws;
+    };
+
+    struct MemoryUsage {
+        //device memory allocated by the engine, and how much of it is in use by resources
+        uint64_t blockBytes;
+        uint64_t allocationBytes;
+        //what the driver reports for the whole process, summed over heaps
+        uint64_t usage;
+        uint64_t budget;
+    };
+
+    void        init_engine(const EngineOptions& options = {});
     void        run();
     void        cleanup();
+    //frames that made it to present, or to their offscreen image
+    uint64_t    frames_rendered();
+    //only valid once run() has returned
+    const std::vector<FrameTiming>& frame_timings();
+    MemoryUsage memory_usage();
 }
@@ -6,16 +6,52 @@
 #include <chrono>
 #include "texgui.h"
 #include "mesh.hpp"
+#include "render_queue.hpp"
+#include "lib/jobs.hpp"
+#include "uniform_ring.hpp"
+#include "material.hpp"
+#include "shader_watch.hpp"
+#include "pipeline_variants.hpp"
+#include "render_graph.hpp"
+#include "async_compute.hpp"
+#include "present.hpp"
+#include "latency.hpp"
+#include "gpu_profiler.hpp"
+#include "frame_snapshot.hpp"
+#include "render.hpp"
 namespace vkengine {
 
 inline VkDescriptorSetLayout computeImageDescLayout;
 inline VkDescriptorSetLayout uniformDescLayout;
 inline VkDescriptorSet       computeImageDesc;
+inline VkDescriptorSet       globalDescriptor;
 inline VkPipeline            computePipeline;
-inline VkPipeline            vertexPipeline;
 inline VkPipelineLayout      computePipelineLayout;
 inline VkPipelineLayout      vertexPipelineLayout;
 
+//shared by every pipeline creation, persisted between runs
+constexpr const char*  PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+inline VkPipelineCache pipelineCache;
+
+//pipelines referenced by draw keys, one slot per mesh pipeline variant
+inline VkPipeline            drawPipelines[drawkey::MAX_PIPELINES];
+inline VariantCache          meshVariants;
+inline std::vector<uint32_t> materialPipelines;
+
+//rebuild pipelines when a shader in assets/shaders is saved
+#ifdef DBG
+constexpr bool SHADER_HOT_RELOAD = true;
+#else
+constexpr bool SHADER_HOT_RELOAD = false;
+#endif
+//the build copies assets next to the binary, edits happen in the source tree
+#ifdef VKENGINE_SHADER_SOURCE_DIR
+constexpr const char* SHADER_SOURCE_DIR = VKENGINE_SHADER_SOURCE_DIR;
+#else
+constexpr const char* SHADER_SOURCE_DIR = "assets/shaders";
+#endif
+inline ShaderWatcher shaderWatcher;
+
 constexpr int      STORAGE_COUNT = 65536;
 constexpr int      SAMPLER_COUNT = 65536;
 constexpr int      IMAGE_COUNT   = 65536;
@@ -24,11 +60,13 @@ constexpr uint32_t STORAGE_BINDING = 0;
 constexpr uint32_t SAMPLER_BINDING = 1;
 constexpr uint32_t VERTEX_BINDING  = 2;
 constexpr uint32_t INDEX_BINDING   = 3;
+constexpr uint32_t IMAGE_BINDING   = 4;
 
 inline VkDescriptorSetLayout samplerDescriptorSetLayout;
 inline VkDescriptorSet       samplerDescriptorSet;
 inline VkSampler             linearSampler;
 inline VkSampler             nearestSampler;
+inline BindlessRegistry      bindless;
 
 struct ComputePushConstants {
     glm::vec4 data1;
@@ -37,40 +75,121 @@ struct ComputePushConstants {
     glm::vec4 data4;
 };
 
+//everything else about a draw is read from its GPUDrawData
 struct VertexPushConstants {
-    int             diffuse;
-    int             normal;
-    int             specular;
+    uint32_t drawId;
+};
+
+//matches DrawData in mesh.vert (std430), written to the uniform ring every frame in queue order
+struct GPUDrawData {
     glm::mat4       worldMatrix;
     VkDeviceAddress vertexBuffer;
+    uint32_t        materialId;
+    uint32_t        pad;
 };
 
 struct GPUSceneData {
-    glm::mat4 view;
-    glm::mat4 proj;
+    glm::mat4       view;
+    glm::mat4       proj;
+    VkDeviceAddress materials;
+    VkDeviceAddress draws;
 };
 
 inline GPUSceneData sceneData = {};
 
-inline Model guitar;
+//also holds the per frame draw data, which may use half of it: about 50k draws
+constexpr VkDeviceSize UNIFORM_RING_FRAME_SIZE = 8 * 1024 * 1024;
+inline UniformRing     uniformRing;
+
+//a mesh of sceneModel placed in the world, the draw index of a draw key is an instance
+struct Instance {
+    uint32_t  mesh;
+    glm::mat4 transform;
+};
+
+inline Model                 sceneModel;
+inline std::vector<Instance> instances;
+inline Bounds                sceneBounds;
+inline MaterialTable         materialTable;
+
+//the largest instances of the scene are rasterized as occluders every frame
+constexpr uint32_t           OCCLUDER_COUNT = 8;
+inline std::vector<uint32_t> occluders;
+inline OcclusionBuffer       occlusionBuffer;
 
 //some settings
 inline bool FPS_UNLIMITED = false;
 inline int FPS_LIMIT = 240;
 inline int TICK_LIMIT = 240;
+inline bool OCCLUSION_CULLING = true;
+inline VkPresentModeKHR PRESENT_MODE = VK_PRESENT_MODE_FIFO_KHR;
+inline bool PRESENT_THREAD = true;
+//up to MAX_FRAMES_IN_FLIGHT, changing it waits for the GPU once
+inline int FRAMES_IN_FLIGHT = 2;
+//one frame in flight, frames start just in time for the GPU and input is sampled again right before culling
+inline bool LOW_LATENCY = false;
+inline float LOW_LATENCY_MARGIN_MS = 1.0f;
+//stop rendering once input, camera and UI have stopped changing, and sleep until the next window event
+inline bool RENDER_ON_DEMAND = true;
+//set from EngineOptions at init
+inline bool HEADLESS = false;
+inline uint32_t FRAME_COUNT = 0;
+inline const char* READBACK_PATH = nullptr;
+inline uint32_t CAMERA_PATH_FRAMES = 0;
+inline bool RECORD_TIMINGS = false;
+inline std::vector<FrameTiming> frameTimings;
+//frames rendered after the last change before going idle, ImGui needs a couple to settle hover states
+constexpr uint32_t IDLE_SETTLE_FRAMES = 3;
+//a frame is still rendered this often while idle, so stats and shader reloads do show up
+constexpr double IDLE_TIMEOUT_S = 1.0;
 inline std::chrono::nanoseconds delta(0);
 
+//simulation tick length, time not yet simulated, and how far the rendered frame is into the next tick
 inline std::chrono::nanoseconds tick(0);
-
-inline uint32_t currentTextureIndex = 0;
+inline std::chrono::nanoseconds tickAccumulator(0);
+inline double                   tickAlpha           = 0.0;
+constexpr uint32_t              MAX_TICKS_PER_FRAME = 8;
 
 inline uint32_t selected = 0;
 inline TexGui::RenderData data; 
-inline TexGui::RenderData copy; 
 inline char charbuf[128] = "\0";
 
-inline spock::Image color_attachment0;
-inline spock::Image depth_attachment0;
+constexpr VkFormat        COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+constexpr VkFormat        DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+inline spock::Image      color_attachment0;
+inline RenderGraph       frameGraph;
+inline AsyncCompute      asyncCompute;
+inline Presenter         presenter;
+inline GpuProfiler       gpuProfiler;
+inline LatencyController latency;
+
+//2 lets the main thread build frame N+1 while frame N is recorded and submitted
+constexpr uint32_t                    SNAPSHOT_COUNT = 2;
+inline SnapshotQueue<SNAPSHOT_COUNT> snapshots;
+
+//geometry recording is split into chunks once the queue gets big enough,
+//every chunk has its own pool and secondary command buffer per frame in flight
+constexpr uint32_t     MAX_RECORD_CHUNKS         = 16;
+constexpr uint32_t     PARALLEL_RECORD_MIN_DRAWS = 2048;
+inline bool            PARALLEL_RECORDING        = true;
+inline uint32_t        recordChunks              = 0;
+inline VkCommandPool   recordPools[MAX_FRAMES_IN_FLIGHT][MAX_RECORD_CHUNKS];
+inline VkCommandBuffer recordBuffers[MAX_FRAMES_IN_FLIGHT][MAX_RECORD_CHUNKS];
+
+//shared by startup pipeline creation and parallel command recording
+inline JobPool workers;
+
+//how much of the most recent cpu profiler zones the flame view shows, and where it exports traces to
+inline float          FLAME_WINDOW_MS = 33.f;
+constexpr const char* TRACE_PATH      = "trace.json";
+
+//what spock::init creates the device with, it can't be queried from the device afterwards.
+//it gets a queue in every family, like vk-bootstrap does by default
+constexpr bool DEVICE_QUEUE_PER_FAMILY = true;
+
+//per pass gpu timings
+inline bool           GPU_PROFILER         = true;
+constexpr const char* GPU_PROFILE_CSV_PATH = "gpu_passes.csv";
 
 
 }
@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <cstdlib>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "present.hpp"
+#include "render_graph.hpp"
+
+using namespace vkengine;
+
+namespace {
+    struct AccessInfo {
+        VkImageLayout         layout;
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2        read;
+        VkAccessFlags2        write;
+    };
+
+    constexpr AccessInfo accessInfo[ACCESS_Count] = {
+        {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT,
+         VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT},
+        {VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT},
+        {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, 0},
+        {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT},
+        {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, 0},
+        {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, 0},
+        {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, 0},
+        {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, 0, VK_ACCESS_2_TRANSFER_WRITE_BIT},
+    };
+
+    //memory shared by transients that are never alive at the same time
+    struct Heap {
+        VkMemoryRequirements requirements;
+        uint32_t             lastPass;
+    };
+
+    bool is_depth_format(VkFormat format)
+    {
+        return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+               format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_X8_D24_UNORM_PACK32;
+    }
+
+    uint64_t hash_combine(uint64_t hash, uint64_t value)
+    {
+        return (hash ^ value) * 0x100000001B3;
+    }
+}
+
+RenderGraph::Pass& RenderGraph::Pass::read(RGImage image, ImageAccess access)
+{
+    uses.push_back({image, access, true, false});
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::write(RGImage image, ImageAccess access, bool preserve)
+{
+    uses.push_back({image, access, preserve, true});
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::side_effect()
+{
+    sideEffect = true;
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::async_compute()
+{
+    wantsAsync = true;
+    return *this;
+}
+
+void RenderGraph::set_queue_families(uint32_t _graphicsFamily, uint32_t _computeFamily)
+{
+    graphicsFamily = _graphicsFamily;
+    computeFamily  = _computeFamily;
+}
+
+void RenderGraph::begin(uint64_t _frameIdx)
+{
+    frameIdx = _frameIdx;
+    images.clear();
+    passes.clear();
+    barriers.clear();
+    releases.clear();
+    finalBarriers  = 0;
+    asyncWaitStage = VK_PIPELINE_STAGE_2_NONE;
+
+    while (!retired.empty() && retired.front().frame <= frameIdx)
+    {
+        for (Transient& t : retired.front().transients)
+        {
+            vkDestroyImageView(spock::ctx.device, t.view, nullptr);
+            vkDestroyImage(spock::ctx.device, t.image, nullptr);
+        }
+        for (VmaAllocation heap : retired.front().heaps)
+            vmaFreeMemory(spock::ctx.allocator, heap);
+        retired.pop_front();
+    }
+}
+
+RGImage RenderGraph::import_image(const char* name, VkImage image, VkImageView view, VkImageAspectFlags aspect, VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+    Image& i        = images.emplace_back();
+    i.name          = name;
+    i.image         = image;
+    i.view          = view;
+    i.aspect        = aspect;
+    i.initialLayout = initialLayout;
+    i.finalLayout   = finalLayout;
+    return {uint32_t(images.size() - 1)};
+}
+
+RGImage RenderGraph::create_image(const char* name, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage)
+{
+    Image& i        = images.emplace_back();
+    i.name          = name;
+    i.aspect        = is_depth_format(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    i.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    i.finalLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+    i.transient     = true;
+    i.extent        = extent;
+    i.format        = format;
+    i.usage         = usage;
+    return {uint32_t(images.size() - 1)};
+}
+
+RenderGraph::Pass& RenderGraph::add_pass(const char* name, std::function<void(VkCommandBuffer)> execute)
+{
+    Pass& pass   = passes.emplace_back();
+    pass.name    = name;
+    pass.execute = std::move(execute);
+    return pass;
+}
+
+void RenderGraph::cull()
+{
+    //walk backwards from the outputs, a pass survives if something later needs what it writes
+    std::vector<bool> needed(images.size());
+    for (size_t i = 0; i < images.size(); i++)
+        needed[i] = images[i].finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        Pass& pass = passes[i];
+        pass.alive = pass.sideEffect || std::any_of(pass.uses.begin(), pass.uses.end(), [&](const Pass::Use& u) { return u.write && needed[u.image.id]; });
+        if (!pass.alive)
+        {
+            stats.culled++;
+            continue;
+        }
+
+        //whatever an overwriting pass replaces is not needed from earlier passes, unless it also reads it
+        for (const Pass::Use& use : pass.uses)
+            if (use.write && !use.read)
+                needed[use.image.id] = false;
+        for (const Pass::Use& use : pass.uses)
+            if (use.read)
+                needed[use.image.id] = true;
+    }
+
+    for (Image& image : images)
+        image.firstPass = image.lastPass = UINT32_MAX;
+    for (uint32_t i = 0; i < passes.size(); i++)
+    {
+        if (!passes[i].alive)
+            continue;
+        for (const Pass::Use& use : passes[i].uses)
+        {
+            Image& image    = images[use.image.id];
+            image.firstPass = std::min(image.firstPass, i);
+            image.lastPass  = image.lastPass == UINT32_MAX ? i : std::max(image.lastPass, i);
+        }
+    }
+}
+
+void RenderGraph::assign_queues()
+{
+    //an async pass may only touch images whose earlier contents it doesn't need, or that only async
+    //passes have touched so far this frame. Everything else would need graphics to hand the image
+    //over first, which would serialise the queues anyway. Outputs always end on graphics
+    std::vector<bool> async(images.size()), graphics(images.size());
+    for (Pass& pass : passes)
+    {
+        if (!pass.alive)
+            continue;
+
+        pass.queue = QUEUE_Graphics;
+        if (pass.wantsAsync && computeFamily != UINT32_MAX)
+        {
+            bool ok = std::all_of(pass.uses.begin(), pass.uses.end(), [&](const Pass::Use& u) {
+                const Image& image = images[u.image.id];
+                return !graphics[u.image.id] && image.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED && (async[u.image.id] || (u.write && !u.read));
+            });
+            if (ok)
+            {
+                pass.queue = QUEUE_AsyncCompute;
+                stats.asyncPasses++;
+            }
+        }
+
+        for (const Pass::Use& use : pass.uses)
+            (pass.queue == QUEUE_AsyncCompute ? async : graphics)[use.image.id] = true;
+    }
+}
+
+void RenderGraph::retire_transients()
+{
+    if (transients.empty() && heaps.empty())
+        return;
+    retired.push_back({std::move(transients), std::move(heaps), frameIdx + MAX_FRAMES_IN_FLIGHT});
+    transients.clear();
+    heaps.clear();
+}
+
+void RenderGraph::allocate_transients()
+{
+    std::vector<uint32_t> used;
+    uint64_t              key = 0xCBF29CE484222325;
+    for (uint32_t i = 0; i < images.size(); i++)
+    {
+        const Image& image = images[i];
+        if (!image.transient || image.firstPass == UINT32_MAX)
+            continue;
+        used.push_back(i);
+        key = hash_combine(key, uint64_t(image.extent.width) << 32 | image.extent.height);
+        key = hash_combine(key, uint64_t(image.format) << 32 | image.usage);
+        key = hash_combine(key, uint64_t(image.firstPass) << 32 | image.lastPass);
+    }
+
+    //the same graph as last frame gets the same images back, a different one gets a new set and the
+    //old one is freed once the frames in flight are done with it
+    if (key != transientKey || transients.size() != used.size())
+    {
+        retire_transients();
+        transientKey   = key;
+        requestedBytes = 0;
+        heapBytes      = 0;
+
+        std::vector<VkMemoryRequirements> requirements(used.size());
+        for (uint32_t i : used)
+        {
+            const Image&      image = images[i];
+            VkImageCreateInfo info  = {.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            info.imageType          = VK_IMAGE_TYPE_2D;
+            info.format             = image.format;
+            info.extent             = {image.extent.width, image.extent.height, 1};
+            info.mipLevels          = 1;
+            info.arrayLayers        = 1;
+            info.samples            = VK_SAMPLE_COUNT_1_BIT;
+            info.tiling             = VK_IMAGE_TILING_OPTIMAL;
+            info.usage              = image.usage;
+            info.initialLayout      = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            Transient& t = transients.emplace_back();
+            VK_CHECK(vkCreateImage(spock::ctx.device, &info, nullptr, &t.image));
+            vkGetImageMemoryRequirements(spock::ctx.device, t.image, &requirements[transients.size() - 1]);
+            requestedBytes += requirements[transients.size() - 1].size;
+        }
+
+        //first fit in order of first use, a heap can be reused once its last occupant is done
+        std::vector<uint32_t> order(used.size());
+        std::vector<uint32_t> heapOf(used.size());
+        std::vector<Heap>     plan;
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return images[used[a]].firstPass < images[used[b]].firstPass; });
+        for (uint32_t t : order)
+        {
+            const Image&                image = images[used[t]];
+            const VkMemoryRequirements& req   = requirements[t];
+            auto                        heap  = std::find_if(plan.begin(), plan.end(), [&](const Heap& h) {
+                return h.lastPass < image.firstPass && (h.requirements.memoryTypeBits & req.memoryTypeBits) != 0;
+            });
+            if (heap == plan.end())
+            {
+                plan.push_back({req, image.lastPass});
+                heapOf[t] = plan.size() - 1;
+                continue;
+            }
+            heap->requirements.size           = std::max(heap->requirements.size, req.size);
+            heap->requirements.alignment      = std::max(heap->requirements.alignment, req.alignment);
+            heap->requirements.memoryTypeBits &= req.memoryTypeBits;
+            heap->lastPass                    = image.lastPass;
+            heapOf[t]                         = heap - plan.begin();
+        }
+
+        VmaAllocationCreateInfo allocInfo = {.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+        for (const Heap& h : plan)
+        {
+            VmaAllocation allocation;
+            VK_CHECK(vmaAllocateMemory(spock::ctx.allocator, &h.requirements, &allocInfo, &allocation, nullptr));
+            heaps.push_back(allocation);
+        }
+
+        for (uint32_t t = 0; t < used.size(); t++)
+        {
+            const Image& image = images[used[t]];
+            VK_CHECK(vmaBindImageMemory(spock::ctx.allocator, heaps[heapOf[t]], transients[t].image));
+
+            VkImageViewCreateInfo view = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            view.image                 = transients[t].image;
+            view.viewType              = VK_IMAGE_VIEW_TYPE_2D;
+            view.format                = image.format;
+            view.subresourceRange      = {image.aspect, 0, 1, 0, 1};
+            VK_CHECK(vkCreateImageView(spock::ctx.device, &view, nullptr, &transients[t].view));
+        }
+
+        for (const Heap& h : plan)
+            heapBytes += h.requirements.size;
+    }
+
+    for (uint32_t t = 0; t < used.size(); t++)
+    {
+        images[used[t]].image = transients[t].image;
+        images[used[t]].view  = transients[t].view;
+    }
+    stats.transientBytes = requestedBytes;
+    stats.allocatedBytes = heapBytes;
+}
+
+void RenderGraph::add_barriers()
+{
+    struct State {
+        VkImageLayout         layout;
+        VkPipelineStageFlags2 stage   = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2        access  = VK_ACCESS_2_NONE;
+        bool                  written = false;
+        bool                  touched = false;
+        PassQueue             queue   = QUEUE_Graphics;
+    };
+
+    std::vector<State> states(images.size());
+    for (size_t i = 0; i < images.size(); i++)
+        states[i].layout = images[i].initialLayout;
+
+    auto barrier = [&](uint32_t image, const State& s, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+        VkImageMemoryBarrier2 b = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        //the first use in a frame has to wait for whatever touched the image (or memory it aliases) before
+        b.srcStageMask     = s.touched ? s.stage : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        b.srcAccessMask    = s.touched ? (s.written ? s.access : VK_ACCESS_2_NONE) : VK_ACCESS_2_MEMORY_WRITE_BIT;
+        b.dstStageMask     = dstStage;
+        b.dstAccessMask    = dstAccess;
+        b.oldLayout        = oldLayout;
+        b.newLayout        = newLayout;
+        b.image            = images[image].image;
+        b.subresourceRange = {images[image].aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+        barriers.push_back(b);
+    };
+
+    for (Pass& pass : passes)
+    {
+        if (!pass.alive)
+            continue;
+
+        pass.firstBarrier = barriers.size();
+        for (const Pass::Use& use : pass.uses)
+        {
+            const AccessInfo& info   = accessInfo[use.access];
+            VkAccessFlags2    access = (use.read ? info.read : 0) | (use.write ? info.write : 0);
+            State&            s      = states[use.image.id];
+
+            //assign_queues only lets images move from async compute to graphics. The semaphore orders
+            //the queues, and contents that are kept need a release on compute and a matching acquire here
+            if (s.touched && s.queue != pass.queue)
+            {
+                asyncWaitStage |= info.stage;
+                if (use.read)
+                {
+                    VkImageMemoryBarrier2 release = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+                    release.srcStageMask          = s.stage;
+                    release.srcAccessMask         = s.written ? s.access : VK_ACCESS_2_NONE;
+                    release.oldLayout             = s.layout;
+                    release.newLayout             = info.layout;
+                    release.srcQueueFamilyIndex   = computeFamily;
+                    release.dstQueueFamilyIndex   = graphicsFamily;
+                    release.image                 = images[use.image.id].image;
+                    release.subresourceRange      = {images[use.image.id].aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+                    releases.push_back(release);
+
+                    VkImageMemoryBarrier2 acquire = release;
+                    acquire.srcStageMask          = VK_PIPELINE_STAGE_2_NONE;
+                    acquire.srcAccessMask         = VK_ACCESS_2_NONE;
+                    acquire.dstStageMask          = info.stage;
+                    acquire.dstAccessMask         = access;
+                    barriers.push_back(acquire);
+                }
+                else
+                {
+                    barrier(use.image.id, {}, VK_IMAGE_LAYOUT_UNDEFINED, info.layout, info.stage, access);
+                }
+                s = {info.layout, info.stage, access, use.write, true, pass.queue};
+                continue;
+            }
+
+            //reads in the same layout share the earlier barriers, later writers wait on all of them. A reader
+            //whose stage or access no earlier barrier covered gets one chained after the readers before it,
+            //which makes the last write visible to it too
+            if (s.touched && !s.written && !use.write && s.layout == info.layout)
+            {
+                if ((info.stage & ~s.stage) || (access & ~s.access))
+                    barrier(use.image.id, s, s.layout, info.layout, info.stage, access);
+                s.stage  |= info.stage;
+                s.access |= access;
+                continue;
+            }
+
+            //an overwrite doesn't care about the old contents, so the transition can discard them
+            barrier(use.image.id, s, use.write && !use.read ? VK_IMAGE_LAYOUT_UNDEFINED : s.layout, info.layout, info.stage, access);
+            s = {info.layout, info.stage, access, use.write, true, pass.queue};
+        }
+        pass.barrierCount = barriers.size() - pass.firstBarrier;
+    }
+
+    const size_t first = barriers.size();
+    for (uint32_t i = 0; i < images.size(); i++)
+        if (images[i].finalLayout != VK_IMAGE_LAYOUT_UNDEFINED && images[i].finalLayout != states[i].layout)
+            barrier(i, states[i], states[i].layout, images[i].finalLayout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE);
+    finalBarriers = barriers.size() - first;
+}
+
+void RenderGraph::compile()
+{
+    stats        = {};
+    stats.passes = passes.size();
+    cull();
+    assign_queues();
+    allocate_transients();
+    add_barriers();
+    stats.imageBarriers = barriers.size() + releases.size();
+}
+
+void RenderGraph::execute(VkCommandBuffer graphics, VkCommandBuffer compute, GpuProfiler* profiler)
+{
+    auto flush = [&](VkCommandBuffer cmd, const VkImageMemoryBarrier2* first, uint32_t count) {
+        if (count == 0)
+            return;
+        VkDependencyInfo dependency        = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency.imageMemoryBarrierCount = count;
+        dependency.pImageMemoryBarriers    = first;
+        vkCmdPipelineBarrier2(cmd, &dependency);
+        stats.barrierBatches++;
+    };
+
+    for (Pass& pass : passes)
+    {
+        if (!pass.alive)
+            continue;
+        VkCommandBuffer cmd = pass.queue == QUEUE_AsyncCompute ? compute : graphics;
+        flush(cmd, barriers.data() + pass.firstBarrier, pass.barrierCount);
+        if (profiler)
+            profiler->begin_pass(cmd, pass.name, pass.queue == QUEUE_AsyncCompute);
+        pass.execute(cmd);
+        if (profiler)
+            profiler->end_pass(cmd);
+    }
+    if (!releases.empty())
+        flush(compute, releases.data(), releases.size());
+    flush(graphics, barriers.data() + barriers.size() - finalBarriers, finalBarriers);
+}
+
+void RenderGraph::destroy()
+{
+    retire_transients();
+    begin(UINT64_MAX);
+}
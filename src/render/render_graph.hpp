@@ -0,0 +1,164 @@
+#pragma once
+//Frame graph.
+//Passes are added every frame together with the images they read and write. compile() culls the
+//passes whose results never reach an output, works out the layout transitions and hazards between
+//the remaining ones and batches them into one vkCmdPipelineBarrier2 per pass. Transient images are
+//owned by the graph, and transients whose lifetimes don't overlap share the same memory.
+//Passes can ask for the async compute queue. They get it if everything they touch is either
+//overwritten or only used by other async passes before them, and their results are handed to the
+//graphics queue through queue family ownership transfers.
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+#include "vk_mem_alloc.h"
+
+namespace vkengine {
+    struct GpuProfiler;
+
+    //how a pass touches an image, each one maps to a layout, pipeline stages and access flags
+    enum ImageAccess {
+        ACCESS_ColorAttachment = 0,
+        ACCESS_DepthAttachment,
+        ACCESS_ComputeRead,
+        ACCESS_ComputeWrite,
+        ACCESS_FragmentSampled,
+        ACCESS_ComputeSampled,
+        ACCESS_TransferSrc,
+        ACCESS_TransferDst,
+        ACCESS_Count
+    };
+
+    enum PassQueue {
+        QUEUE_Graphics     = 0,
+        QUEUE_AsyncCompute = 1,
+    };
+
+    struct RGImage {
+        uint32_t id = ~0u;
+    };
+
+    struct RenderGraphStats {
+        uint32_t     passes         = 0;
+        uint32_t     culled         = 0;
+        uint32_t     barrierBatches = 0;
+        uint32_t     imageBarriers  = 0;
+        uint32_t     asyncPasses    = 0;
+        //what the transients would take without aliasing, and what they actually take
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize allocatedBytes = 0;
+    };
+
+    struct RenderGraph {
+        struct Pass {
+            //preserve = false means the pass overwrites every texel, so earlier contents are discarded
+            Pass& read(RGImage image, ImageAccess access);
+            Pass& write(RGImage image, ImageAccess access, bool preserve = true);
+            //keeps the pass even if nothing it writes is used afterwards
+            Pass& side_effect();
+            //runs the pass on the async compute queue when the graph can, the pass has to be compute only
+            Pass& async_compute();
+
+          private:
+            friend struct RenderGraph;
+            struct Use {
+                RGImage     image;
+                ImageAccess access;
+                bool        read;
+                bool        write;
+            };
+
+            const char*                          name;
+            std::function<void(VkCommandBuffer)> execute;
+            std::vector<Use>                     uses;
+            bool                                 sideEffect   = false;
+            bool                                 wantsAsync   = false;
+            bool                                 alive        = false;
+            PassQueue                            queue        = QUEUE_Graphics;
+            uint32_t                             firstBarrier = 0;
+            uint32_t                             barrierCount = 0;
+        };
+
+        RenderGraphStats stats;
+
+        //computeFamily == UINT32_MAX keeps every pass on the graphics queue
+        void    set_queue_families(uint32_t graphicsFamily, uint32_t computeFamily);
+        //clears the passes of the previous frame and retires transient memory the GPU is done with
+        void    begin(uint64_t frameIdx);
+        //the graph only tracks the layout of imported images within the frame. A final layout other than
+        //UNDEFINED makes the image an output of the frame and it is transitioned there at the end
+        RGImage import_image(const char* name, VkImage image, VkImageView view, VkImageAspectFlags aspect, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                             VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+        //contents do not survive the frame
+        RGImage create_image(const char* name, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage);
+        Pass&   add_pass(const char* name, std::function<void(VkCommandBuffer)> execute);
+
+        void    compile();
+        //compute is only recorded into when a pass ended up on the async queue, profiler times every pass
+        void    execute(VkCommandBuffer graphics, VkCommandBuffer compute = VK_NULL_HANDLE, GpuProfiler* profiler = nullptr);
+        //frees every transient, the device must be idle
+        void    destroy();
+
+        bool                  uses_async() const { return stats.asyncPasses > 0; }
+        //stages of the graphics work that consume async results, the graphics submit waits there
+        VkPipelineStageFlags2 async_wait_stage() const { return asyncWaitStage; }
+
+        VkImage     image(RGImage image) const { return images[image.id].image; }
+        VkImageView view(RGImage image) const { return images[image.id].view; }
+
+      private:
+        struct Image {
+            const char*        name;
+            VkImage            image  = VK_NULL_HANDLE;
+            VkImageView        view   = VK_NULL_HANDLE;
+            VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+            VkImageLayout      initialLayout;
+            VkImageLayout      finalLayout;
+            //only set for transients
+            bool               transient = false;
+            VkExtent2D         extent;
+            VkFormat           format;
+            VkImageUsageFlags  usage;
+            //first and last pass using the image, UINT32_MAX if no pass that survived culling does
+            uint32_t           firstPass;
+            uint32_t           lastPass;
+        };
+
+        struct Transient {
+            VkImage     image = VK_NULL_HANDLE;
+            VkImageView view  = VK_NULL_HANDLE;
+        };
+
+        struct Retired {
+            std::vector<Transient>     transients;
+            std::vector<VmaAllocation> heaps;
+            uint64_t                   frame;
+        };
+
+        void cull();
+        void assign_queues();
+        void allocate_transients();
+        void add_barriers();
+        void retire_transients();
+
+        std::vector<Image>                 images;
+        std::deque<Pass>                   passes;
+        std::vector<VkImageMemoryBarrier2> barriers;
+        //recorded at the end of the compute command buffer, handing async results to graphics
+        std::vector<VkImageMemoryBarrier2> releases;
+        uint32_t                           finalBarriers  = 0;
+        uint64_t                           frameIdx       = 0;
+        uint32_t                           graphicsFamily = 0;
+        uint32_t                           computeFamily  = UINT32_MAX;
+        VkPipelineStageFlags2              asyncWaitStage = VK_PIPELINE_STAGE_2_NONE;
+
+        //transients are kept between frames as long as the graph asks for the same ones
+        uint64_t                   transientKey   = 0;
+        VkDeviceSize               requestedBytes = 0;
+        VkDeviceSize               heapBytes      = 0;
+        std::vector<Transient>     transients;
+        std::vector<VmaAllocation> heaps;
+        std::deque<Retired>        retired;
+    };
+}
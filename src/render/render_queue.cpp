@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include "render_queue.hpp"
+
+using namespace vkengine;
+
+namespace {
+    constexpr uint64_t mask(uint32_t bits) { return (uint64_t(1) << bits) - 1; }
+
+    using namespace drawkey;
+    constexpr uint32_t DRAW_SHIFT = 0;
+    constexpr uint32_t PASS_SHIFT = 64 - PASS_BITS;
+
+    //opaque layout
+    constexpr uint32_t O_DEPTH_SHIFT    = DRAW_SHIFT + DRAW_BITS;
+    constexpr uint32_t O_MATERIAL_SHIFT = O_DEPTH_SHIFT + DEPTH_BITS;
+    constexpr uint32_t O_PIPELINE_SHIFT = O_MATERIAL_SHIFT + MATERIAL_BITS;
+
+    //blended layout
+    constexpr uint32_t B_MATERIAL_SHIFT = DRAW_SHIFT + DRAW_BITS;
+    constexpr uint32_t B_PIPELINE_SHIFT = B_MATERIAL_SHIFT + MATERIAL_BITS;
+    constexpr uint32_t B_DEPTH_SHIFT    = B_PIPELINE_SHIFT + PIPELINE_BITS;
+
+    static_assert(O_PIPELINE_SHIFT + PIPELINE_BITS == PASS_SHIFT);
+    static_assert(B_DEPTH_SHIFT + DEPTH_BITS == PASS_SHIFT);
+}
+
+uint32_t drawkey::depth_bucket(float depth)
+{
+    return std::bit_cast<uint32_t>(std::max(depth, 0.f)) >> (31 - DEPTH_BITS);
+}
+
+uint64_t drawkey::make(DrawPass pass, uint32_t pipeline, uint32_t material, float depth, uint32_t draw)
+{
+    assert(pipeline < MAX_PIPELINES && material < MAX_MATERIALS && draw < MAX_DRAWS);
+    uint64_t d   = depth_bucket(depth);
+    uint64_t key = uint64_t(pass) << PASS_SHIFT | uint64_t(draw) << DRAW_SHIFT;
+    if (pass == PASS_Blended)
+        return key | (~d & mask(DEPTH_BITS)) << B_DEPTH_SHIFT | uint64_t(pipeline) << B_PIPELINE_SHIFT | uint64_t(material) << B_MATERIAL_SHIFT;
+    return key | uint64_t(pipeline) << O_PIPELINE_SHIFT | uint64_t(material) << O_MATERIAL_SHIFT | d << O_DEPTH_SHIFT;
+}
+
+DrawPass drawkey::pass(uint64_t key)
+{
+    return DrawPass(key >> PASS_SHIFT);
+}
+
+uint32_t drawkey::pipeline(uint64_t key)
+{
+    return (key >> (pass(key) == PASS_Blended ? B_PIPELINE_SHIFT : O_PIPELINE_SHIFT)) & mask(PIPELINE_BITS);
+}
+
+uint32_t drawkey::material(uint64_t key)
+{
+    return (key >> (pass(key) == PASS_Blended ? B_MATERIAL_SHIFT : O_MATERIAL_SHIFT)) & mask(MATERIAL_BITS);
+}
+
+uint32_t drawkey::draw(uint64_t key)
+{
+    return (key >> DRAW_SHIFT) & mask(DRAW_BITS);
+}
+
+void vkengine::radix_sort(std::span<uint64_t> keys, std::span<uint64_t> scratch)
+{
+    assert(scratch.size() >= keys.size());
+    const size_t count = keys.size();
+    if (count < 2)
+        return;
+
+    //every histogram is built in a single read of the keys
+    uint32_t histogram[8][256] = {};
+    for (uint64_t key : keys)
+        for (int digit = 0; digit < 8; digit++)
+            histogram[digit][(key >> (digit * 8)) & 0xFF]++;
+
+    uint64_t* src = keys.data();
+    uint64_t* dst = scratch.data();
+    for (int digit = 0; digit < 8; digit++)
+    {
+        uint32_t* h = histogram[digit];
+        //every key has the same value for this digit, the pass would not move anything
+        if (h[(src[0] >> (digit * 8)) & 0xFF] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t c = h[i];
+            h[i]       = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t key = src[i];
+            dst[h[(key >> (digit * 8)) & 0xFF]++] = key;
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != keys.data())
+        memcpy(keys.data(), src, count * sizeof(uint64_t));
+}
+
+void RenderQueue::sort()
+{
+    if (scratch.size() < keys.size())
+        scratch.resize(keys.size());
+    radix_sort(keys, scratch);
+}
+
+SortBenchmark vkengine::benchmark_draw_key_sort(uint32_t count, uint32_t iterations)
+{
+    namespace stc = std::chrono;
+
+    //fixed seed so runs are comparable
+    uint64_t state = 0x9E3779B97F4A7C15;
+    auto     next  = [&]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    std::vector<uint64_t> source(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t r = next();
+        DrawPass p = (r & 0xF) == 0 ? PASS_Blended : PASS_Opaque;
+        source[i]  = drawkey::make(p, (r >> 4) % 16, (r >> 8) % 1024, float((r >> 20) % 100000) * 0.01f, i % drawkey::MAX_DRAWS);
+    }
+
+    std::vector<uint64_t> keys(count), scratch(count);
+    SortBenchmark         result = {.count = count};
+    for (uint32_t it = 0; it < iterations; it++)
+    {
+        keys    = source;
+        auto t0 = stc::steady_clock::now();
+        radix_sort(keys, scratch);
+        auto t1 = stc::steady_clock::now();
+        assert(std::is_sorted(keys.begin(), keys.end()));
+
+        keys    = source;
+        auto t2 = stc::steady_clock::now();
+        std::sort(keys.begin(), keys.end());
+        auto t3 = stc::steady_clock::now();
+
+        result.radixMs   += stc::duration<double, std::milli>(t1 - t0).count();
+        result.stdSortMs += stc::duration<double, std::milli>(t3 - t2).count();
+    }
+    result.radixMs /= iterations;
+    result.stdSortMs /= iterations;
+    return result;
+}
@@ -0,0 +1,63 @@
+#pragma once
+//Sorted draw submission.
+//Producers push one packed 64 bit key per draw, the queue is radix sorted once per frame and then
+//walked in order, so draws sharing a pipeline and material end up next to each other.
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace vkengine {
+    enum DrawPass {
+        PASS_Opaque  = 0,
+        PASS_Blended = 1,
+    };
+
+    //opaque:  pass:2 | pipeline:8 | material:16 | depth:18 | draw:20, front to back within a state bucket
+    //blended: pass:2 | ~depth:18 | pipeline:8 | material:16 | draw:20, strictly back to front
+    namespace drawkey {
+        constexpr uint32_t PASS_BITS     = 2;
+        constexpr uint32_t PIPELINE_BITS = 8;
+        constexpr uint32_t MATERIAL_BITS = 16;
+        constexpr uint32_t DEPTH_BITS    = 18;
+        constexpr uint32_t DRAW_BITS     = 20;
+
+        constexpr uint32_t MAX_PIPELINES = 1u << PIPELINE_BITS;
+        constexpr uint32_t MAX_MATERIALS = 1u << MATERIAL_BITS;
+        constexpr uint32_t MAX_DRAWS     = 1u << DRAW_BITS;
+
+        //depth is the view distance, the top bits of a positive float sort the same way the float does
+        uint32_t depth_bucket(float depth);
+
+        uint64_t make(DrawPass pass, uint32_t pipeline, uint32_t material, float depth, uint32_t draw);
+
+        DrawPass pass(uint64_t key);
+        uint32_t pipeline(uint64_t key);
+        uint32_t material(uint64_t key);
+        uint32_t draw(uint64_t key);
+    }
+
+    //LSD radix sort over 8 bit digits, digits every key shares are skipped. scratch must be as large as keys
+    void radix_sort(std::span<uint64_t> keys, std::span<uint64_t> scratch);
+
+    struct RenderQueue {
+        std::vector<uint64_t> keys;
+
+        void clear() { keys.clear(); }
+        void push(DrawPass pass, uint32_t pipeline, uint32_t material, float depth, uint32_t draw) { keys.push_back(drawkey::make(pass, pipeline, material, depth, draw)); }
+        void sort();
+
+        const uint64_t* begin() const { return keys.data(); }
+        const uint64_t* end() const { return keys.data() + keys.size(); }
+
+      private:
+        std::vector<uint64_t> scratch;
+    };
+
+    struct SortBenchmark {
+        uint32_t count     = 0;
+        double   radixMs   = 0;
+        double   stdSortMs = 0;
+    };
+    //sorts count random draw keys, averaged over a few runs
+    SortBenchmark benchmark_draw_key_sort(uint32_t count = 100000, uint32_t iterations = 16);
+}
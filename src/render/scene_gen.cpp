@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "scene_gen.hpp"
+
+using namespace vkengine;
+
+namespace {
+    struct Random {
+        uint64_t state;
+
+        uint64_t next()
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+        //uniform in [lo, hi)
+        float range(float lo, float hi) { return lo + (hi - lo) * float(next() >> 40) / float(1 << 24); }
+    };
+
+    //a sphere pushed in and out by a few seeded waves, rings sets the triangle count
+    void displaced_sphere(Random& random, uint32_t rings, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        const uint32_t segments = rings * 2;
+        glm::vec3      freq     = {random.range(1, 6), random.range(1, 6), random.range(1, 6)};
+        float          amp      = random.range(0.f, 0.25f);
+        glm::vec3      stretch  = {random.range(0.5f, 1.5f), random.range(0.5f, 1.5f), random.range(0.5f, 1.5f)};
+
+        for (uint32_t r = 0; r <= rings; r++)
+        {
+            float theta = glm::pi<float>() * r / rings;
+            for (uint32_t s = 0; s <= segments; s++)
+            {
+                float     phi    = glm::two_pi<float>() * s / segments;
+                glm::vec3 normal = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+                float     radius = 1.f + amp * std::sin(freq.x * normal.x + freq.y * normal.y) * std::cos(freq.z * normal.z);
+
+                Vertex v;
+                v.position = normal * radius * stretch;
+                v.normal   = normal;
+                v.uv_x     = float(s) / segments;
+                v.uv_y     = float(r) / rings;
+                v.color    = glm::vec4(normal, 1.f);
+                vertices.push_back(v);
+            }
+        }
+
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < segments; s++)
+            {
+                uint32_t a = r * (segments + 1) + s;
+                uint32_t b = a + segments + 1;
+                indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+            }
+        }
+    }
+
+    spock::Image checkerboard_texture(Random& random, uint32_t size)
+    {
+        glm::vec3 a     = {random.range(0, 1), random.range(0, 1), random.range(0, 1)};
+        glm::vec3 b     = {random.range(0, 1), random.range(0, 1), random.range(0, 1)};
+        uint32_t  cells = 1u << (2 + random.next() % 4);
+
+        const VkDeviceSize bytes   = VkDeviceSize(size) * size * 4;
+        spock::Buffer      staging = spock::create_buffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        uint8_t*           pixels  = (uint8_t*)staging.info.pMappedData;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                glm::vec3 c = ((x * cells / size) + (y * cells / size)) % 2 ? a : b;
+                uint8_t*  p = pixels + (y * size + x) * 4;
+                p[0]        = uint8_t(c.r * 255);
+                p[1]        = uint8_t(c.g * 255);
+                p[2]        = uint8_t(c.b * 255);
+                p[3]        = 255;
+            }
+        }
+
+        spock::Image image = spock::create_image(VkExtent2D{size, size}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+        spock::begin_immediate_command();
+        VkCommandBuffer       cmd     = spock::ctx.immCommandBuffer;
+        VkImageMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        barrier.srcStageMask          = VK_PIPELINE_STAGE_2_NONE;
+        barrier.dstStageMask          = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask         = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout             = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout             = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.image                 = image.image;
+        barrier.subresourceRange      = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        VkDependencyInfo dependency   = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier};
+        vkCmdPipelineBarrier2(cmd, &dependency);
+
+        VkBufferImageCopy region = {};
+        region.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent       = {size, size, 1};
+        vkCmdCopyBufferToImage(cmd, staging.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask  = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier2(cmd, &dependency);
+        spock::end_immediate_command();
+
+        spock::destroy_buffer(staging);
+        return image;
+    }
+}
+
+GeneratedScene vkengine::generate_scene(const SceneDesc& desc)
+{
+    GeneratedScene scene;
+    Random         random = {0x9E3779B97F4A7C15ull ^ (uint64_t(desc.seed) * 0xBF58476D1CE4E5B9ull)};
+
+    for (uint32_t i = 0; i < desc.textures; i++)
+        scene.textures.push_back(checkerboard_texture(random, desc.textureSize));
+
+    for (uint32_t i = 0; i < desc.meshes; i++)
+    {
+        std::vector<Vertex>   vertices;
+        std::vector<uint32_t> indices;
+        displaced_sphere(random, 4 + random.next() % 29, vertices, indices);
+
+        Mesh mesh{};
+        mesh.data = upload_mesh(indices, vertices);
+
+        std::vector<glm::vec3> positions(vertices.size());
+        for (size_t v = 0; v < vertices.size(); v++)
+            positions[v] = vertices[v].position;
+        mesh.bounds   = compute_bounds(positions);
+        mesh.occluder = build_occluder_lod(positions, indices);
+
+        if (!scene.textures.empty())
+            mesh.diffuse = scene.textures[i % scene.textures.size()];
+        mesh.baseColor = glm::vec4(random.range(0.5f, 1), random.range(0.5f, 1), random.range(0.5f, 1), 1.f);
+        scene.model.meshes.push_back(mesh);
+    }
+
+    //about one instance per 27 cubic units, so density stays the same as the count grows
+    float half = 0.5f * 3.f * std::cbrt(float(desc.instances));
+    for (uint32_t i = 0; i < desc.instances && desc.meshes; i++)
+    {
+        glm::vec3 pos   = {random.range(-half, half), random.range(-half, half), random.range(-half, half)};
+        glm::vec3 axis  = glm::normalize(glm::vec3(random.range(-1, 1), random.range(-1, 1), random.range(-1, 1)) + glm::vec3(0.f, 1e-3f, 0.f));
+        float     angle = random.range(0, glm::two_pi<float>());
+        float     scale = random.range(0.5f, 1.5f);
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.f), pos);
+        transform           = glm::rotate(transform, angle, axis);
+        transform           = glm::scale(transform, glm::vec3(scale));
+        scene.instanceMeshes.push_back(random.next() % desc.meshes);
+        scene.instanceTransforms.push_back(transform);
+    }
+    return scene;
+}
+
+void vkengine::destroy_generated_textures(GeneratedScene& scene)
+{
+    for (spock::Image& texture : scene.textures)
+        spock::destroy_image(texture);
+    scene.textures.clear();
+}
+
+glm::mat4 vkengine::camera_path_view(const Bounds& bounds, double t)
+{
+    glm::vec3 centre = (bounds.min + bounds.max) * 0.5f;
+    glm::vec3 extent = bounds.max - bounds.min;
+    //inside the outer shell of the scene, so culling has both near and far work to do
+    float     radius = 0.4f * std::max({extent.x, extent.z, 1.f});
+    double    angle  = glm::two_pi<double>() * t;
+
+    glm::vec3 eye = centre + glm::vec3(std::cos(angle) * radius, 0.15f * extent.y * std::sin(2 * angle), std::sin(angle) * radius);
+    return glm::lookAt(eye, centre, glm::vec3(0, 1, 0));
+}
@@ -0,0 +1,28 @@
+#pragma once
+//Procedural benchmark scenes.
+//Everything is derived from SceneDesc::seed with a fixed xorshift generator, so two runs with the
+//same desc draw exactly the same frames. Meshes are displaced spheres of varying density, textures
+//are tinted checkerboards, and instances are scattered through a cube that grows with their count.
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "spock/types.hpp"
+#include "mesh.hpp"
+#include "render.hpp"
+
+namespace vkengine {
+    struct GeneratedScene {
+        Model                     model;
+        //mesh index and world transform per instance
+        std::vector<uint32_t>     instanceMeshes;
+        std::vector<glm::mat4>    instanceTransforms;
+        //owned by the scene, the meshes only reference them
+        std::vector<spock::Image> textures;
+    };
+
+    GeneratedScene generate_scene(const SceneDesc& desc);
+    void           destroy_generated_textures(GeneratedScene& scene);
+
+    //view matrix on a slow orbit around bounds, t in [0, 1) is one full turn
+    glm::mat4      camera_path_view(const Bounds& bounds, double t);
+}
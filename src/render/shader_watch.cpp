@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include <GLFW/glfw3.h>
+#include "lib/profiler.hpp"
+#include "spock/core.hpp"
+#include "present.hpp"
+#include "shaders.hpp"
+#include "shader_watch.hpp"
+
+using namespace vkengine;
+
+namespace {
+    bool is_shader(const std::filesystem::path& path)
+    {
+        static const char* extensions[] = {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"};
+        std::string        ext          = path.extension().string();
+        return std::any_of(std::begin(extensions), std::end(extensions), [&](const char* e) { return ext == e; });
+    }
+}
+
+void vkengine::build_pipeline(const PipelineSource& source)
+{
+    std::vector<VkShaderModule> modules;
+    for (const char* shader : source.shaders)
+        modules.push_back(load_shader_module(shader));
+
+    *source.pipeline = source.build(modules.data());
+
+    for (VkShaderModule module : modules)
+        vkDestroyShaderModule(spock::ctx.device, module, nullptr);
+}
+
+void ShaderWatcher::start(const char* sourceDir, const char* assetDir)
+{
+#if defined(__linux__)
+    running = true;
+    thread  = std::thread([this, source = std::string(sourceDir), asset = std::string(assetDir)]() { watch_loop(source, asset); });
+#else
+    printf("Shader hot reload is only supported on Linux\n");
+#endif
+}
+
+void ShaderWatcher::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+void ShaderWatcher::add(const PipelineSource& source)
+{
+    std::lock_guard lock(mutex);
+    sources.push_back(source);
+}
+
+void ShaderWatcher::destroy()
+{
+    for (const Retired& r : retired)
+        vkDestroyPipeline(spock::ctx.device, r.pipeline, nullptr);
+    retired.clear();
+}
+
+void ShaderWatcher::apply()
+{
+    frame++;
+    //a pipeline replaced MAX_FRAMES_IN_FLIGHT frames ago can't be bound by any frame still in flight
+    auto done = std::partition(retired.begin(), retired.end(), [&](const Retired& r) { return frame - r.frame < MAX_FRAMES_IN_FLIGHT; });
+    for (auto it = done; it != retired.end(); it++)
+        vkDestroyPipeline(spock::ctx.device, it->pipeline, nullptr);
+    retired.erase(done, retired.end());
+
+    std::lock_guard lock(mutex);
+    for (const Rebuilt& r : ready)
+    {
+        if (*r.slot != VK_NULL_HANDLE)
+            retired.push_back({*r.slot, frame});
+        *r.slot = r.pipeline;
+    }
+    reloads += ready.size();
+    failures = failed;
+    ready.clear();
+}
+
+void ShaderWatcher::rebuild(const std::string& path)
+{
+    std::vector<PipelineSource> dependents;
+    {
+        std::lock_guard lock(mutex);
+        for (const PipelineSource& source : sources)
+            if (std::any_of(source.shaders.begin(), source.shaders.end(), [&](const char* s) { return std::filesystem::path(s) == path; }))
+                dependents.push_back(source);
+    }
+
+    if (dependents.empty())
+    {
+        printf("%s changed, no pipeline uses it\n", path.c_str());
+        return;
+    }
+
+    VkShaderModule changed = reload_shader_module(path.c_str());
+    if (changed == VK_NULL_HANDLE)
+    {
+        std::lock_guard lock(mutex);
+        failed++;
+        return;
+    }
+
+    for (const PipelineSource& source : dependents)
+    {
+        //the other stages are unchanged, so they come straight from the prebuilt or cached spir-v
+        std::vector<VkShaderModule> modules;
+        for (const char* shader : source.shaders)
+            modules.push_back(std::filesystem::path(shader) == path ? changed : load_shader_module(shader));
+
+        VkPipeline pipeline = source.build(modules.data());
+        {
+            std::lock_guard lock(mutex);
+            ready.push_back({source.pipeline, pipeline});
+        }
+
+        for (VkShaderModule module : modules)
+            if (module != changed)
+                vkDestroyShaderModule(spock::ctx.device, module, nullptr);
+    }
+    vkDestroyShaderModule(spock::ctx.device, changed, nullptr);
+}
+
+void ShaderWatcher::watch_loop(std::string sourceDir, std::string assetDir)
+{
+    PROFILE_THREAD_NAME("shader watcher");
+#if defined(__linux__)
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, sourceDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        printf("Failed to watch %s, shader hot reload is disabled\n", sourceDir.c_str());
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (running)
+    {
+        //wake up regularly so stop() never waits on a quiet directory
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        //editors tend to produce a burst of events per save, collect them so each shader builds once
+        std::set<std::string> changed;
+        ssize_t               len;
+        while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + len; p += sizeof(inotify_event) + ((inotify_event*)p)->len)
+            {
+                inotify_event* event = (inotify_event*)p;
+                if (event->len > 0 && is_shader(event->name))
+                    changed.insert(event->name);
+            }
+        }
+
+        for (const std::string& name : changed)
+        {
+            //the pipelines and the prebuilt spir-v refer to the runtime copy, keep it in step with the source
+            std::filesystem::path source = std::filesystem::path(sourceDir) / name;
+            std::filesystem::path asset  = std::filesystem::path(assetDir) / name;
+            std::error_code       err;
+            if (!std::filesystem::equivalent(source, asset, err))
+                std::filesystem::copy_file(source, asset, std::filesystem::copy_options::overwrite_existing, err);
+            if (err)
+                printf("Failed to copy %s to %s: %s\n", source.c_str(), asset.c_str(), err.message().c_str());
+            rebuild(asset.string());
+        }
+        //the render loop may be idle waiting for events, it has to draw a frame to pick up the pipelines
+        if (!changed.empty())
+            glfwPostEmptyEvent();
+    }
+    close(fd);
+#endif
+}
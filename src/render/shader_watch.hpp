@@ -0,0 +1,69 @@
+#pragma once
+//Shader hot reload.
+//Pipelines are registered together with the shaders they are built from. A background thread watches
+//the shader source directory (inotify, Linux only) and when a shader is saved it copies it over the
+//runtime copy, recompiles just that module and rebuilds every pipeline that uses it. Finished
+//pipelines are only handed to the renderer at a frame boundary, so a frame never sees a pipeline
+//change halfway through recording.
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace vkengine {
+    struct PipelineSource {
+        std::vector<const char*> shaders;
+        //builds from modules given in the same order as shaders, against a layout that already exists
+        std::function<VkPipeline(const VkShaderModule* modules)> build;
+        //the slot the renderer binds from
+        VkPipeline* pipeline;
+    };
+
+    //builds a pipeline from its sources, used for the initial build at startup
+    void build_pipeline(const PipelineSource& source);
+
+    struct ShaderWatcher {
+        uint32_t reloads  = 0;
+        uint32_t failures = 0;
+
+        //safe to call from any thread, also after start
+        void add(const PipelineSource& source);
+        //watches sourceDir, the pipelines are registered with the copies in assetDir. They can be the same
+        void start(const char* sourceDir, const char* assetDir);
+        void stop();
+        //destroys the pipelines still waiting to retire, call once the device is idle
+        void destroy();
+
+        //swaps in pipelines that finished rebuilding, call once per frame after the frame's fence wait
+        //and before recording. The pipelines they replace may still be used by frames in flight, they are
+        //destroyed MAX_FRAMES_IN_FLIGHT calls later
+        void apply();
+
+      private:
+        struct Rebuilt {
+            VkPipeline* slot;
+            VkPipeline  pipeline;
+        };
+
+        struct Retired {
+            VkPipeline pipeline;
+            uint64_t   frame;
+        };
+
+        void watch_loop(std::string sourceDir, std::string assetDir);
+        void rebuild(const std::string& path);
+
+        std::vector<PipelineSource> sources;
+        std::thread                 thread;
+        std::atomic<bool>           running = false;
+        std::mutex                  mutex;
+        std::vector<Rebuilt>        ready;
+        uint32_t                    failed = 0;
+        //only touched by apply and destroy, on the render thread
+        std::vector<Retired>        retired;
+        uint64_t                    frame = 0;
+    };
+}
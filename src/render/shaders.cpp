@@ -0,0 +1,306 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#include <glslang/build_info.h>
+#include "lib/util.hpp"
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "shaders.hpp"
+
+using namespace vkengine;
+namespace stc = std::chrono;
+
+namespace {
+    std::once_flag glslangInit;
+    bool           glslangInitialized = false;
+    std::mutex     statsMutex;
+
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+    bool read_file(const std::string& path, std::string& out)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        out = ss.str();
+        return true;
+    }
+
+    uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= ((const uint8_t*)data)[i];
+            hash *= 0x100000001B3;
+        }
+        return hash;
+    }
+
+    EShLanguage stage_from_path(const std::string& path)
+    {
+        std::string ext = std::filesystem::path(path).extension().string();
+        if (ext == ".vert") return EShLangVertex;
+        if (ext == ".frag") return EShLangFragment;
+        if (ext == ".comp") return EShLangCompute;
+        if (ext == ".geom") return EShLangGeometry;
+        if (ext == ".tesc") return EShLangTessControl;
+        if (ext == ".tese") return EShLangTessEvaluation;
+        printf("Unknown shader stage for %s\n", path.c_str());
+        abort();
+    }
+
+    std::string make_preamble(const std::vector<std::string>& defines)
+    {
+        std::string preamble;
+        for (const std::string& define : defines)
+        {
+            size_t eq = define.find('=');
+            if (eq == std::string::npos)
+                preamble += "#define " + define + "\n";
+            else
+                preamble += "#define " + define.substr(0, eq) + " " + define.substr(eq + 1) + "\n";
+        }
+        return preamble;
+    }
+
+    glslang::TShader* make_shader(EShLanguage stage, const char* const* source, const std::string& preamble)
+    {
+        std::call_once(glslangInit, []() { glslangInitialized = glslang::InitializeProcess(); });
+        auto* shader = new glslang::TShader(stage);
+        shader->setStrings(source, 1);
+        shader->setPreamble(preamble.c_str());
+        shader->setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+        shader->setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+        shader->setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+        return shader;
+    }
+
+    //resolves #include "file" relative to the file doing the include, the shader's own directory at the
+    //top level, and keeps every file it opened so their contents can go into the cache key
+    class FileIncluder : public glslang::TShader::Includer
+    {
+      public:
+        struct Dependency {
+            std::string path;
+            std::string source;
+        };
+        //a deque so the text handed to glslang never moves
+        std::deque<Dependency> dependencies;
+
+        explicit FileIncluder(const std::string& shaderPath) : dir(std::filesystem::path(shaderPath).parent_path()) {}
+
+        IncludeResult* includeLocal(const char* header, const char* includer, size_t) override
+        {
+            std::filesystem::path base = includer && *includer ? std::filesystem::path(includer).parent_path() : dir;
+            Dependency            dep  = {(base / header).lexically_normal().string()};
+            if (!read_file(dep.path, dep.source))
+                return nullptr;
+            const Dependency& d = dependencies.emplace_back(std::move(dep));
+            return new IncludeResult(d.path, d.source.data(), d.source.size(), nullptr);
+        }
+
+        void releaseInclude(IncludeResult* result) override { delete result; }
+
+      private:
+        std::filesystem::path dir;
+    };
+
+    //keyed by the raw text, plus the path and text of every file it includes so an edited include
+    //invalidates it too. Sources without includes never touch glslang, a cache hit skips it completely
+    uint64_t cache_key(const std::string& path, EShLanguage stage, const std::string& source, const std::string& preamble)
+    {
+        const int version[3] = {GLSLANG_VERSION_MAJOR, GLSLANG_VERSION_MINOR, GLSLANG_VERSION_PATCH};
+        uint64_t  hash       = 0xCBF29CE484222325;
+        hash                 = fnv1a(hash, source.data(), source.size());
+        if (source.find("#include") != std::string::npos)
+        {
+            //preprocessing is what finds the includes, a failure still leaves whatever it resolved
+            const char*       str    = source.c_str();
+            glslang::TShader* shader = make_shader(stage, &str, preamble);
+            std::string       preprocessed;
+            FileIncluder      includer(path);
+            shader->preprocess(GetDefaultResources(), 100, ENoProfile, false, false, EShMsgDefault, &preprocessed, includer);
+            delete shader;
+            for (const FileIncluder::Dependency& dep : includer.dependencies)
+            {
+                hash = fnv1a(hash, dep.path.data(), dep.path.size());
+                hash = fnv1a(hash, dep.source.data(), dep.source.size());
+            }
+        }
+        hash = fnv1a(hash, preamble.data(), preamble.size());
+        hash                 = fnv1a(hash, &stage, sizeof(stage));
+        hash                 = fnv1a(hash, version, sizeof(version));
+        return hash;
+    }
+}
+
+bool vkengine::try_compile_shader(const char* path, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv)
+{
+    std::string source;
+    if (!read_file(path, source))
+    {
+        printf("Failed to read shader %s\n", path);
+        return false;
+    }
+
+    const EShLanguage stage    = stage_from_path(path);
+    const std::string preamble = make_preamble(defines);
+    const char*       str      = source.c_str();
+
+    glslang::TShader* shader = make_shader(stage, &str, preamble);
+    FileIncluder      includer(path);
+    if (!shader->parse(GetDefaultResources(), 100, false, EShMsgDefault, includer))
+    {
+        printf("Failed to compile shader %s:\n%s\n", path, shader->getInfoLog());
+        log_line(source.c_str());
+        delete shader;
+        return false;
+    }
+
+    glslang::TProgram program;
+    program.addShader(shader);
+    if (!program.link(EShMsgDefault))
+    {
+        printf("Failed to link shader %s:\n%s\n", path, program.getInfoLog());
+        delete shader;
+        return false;
+    }
+
+    spirv.clear();
+    glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
+    delete shader;
+    return true;
+}
+
+std::vector<uint32_t> vkengine::compile_shader(const char* path, const std::vector<std::string>& defines)
+{
+    std::vector<uint32_t> spirv;
+    if (!try_compile_shader(path, defines, spirv))
+        abort();
+    return spirv;
+}
+
+namespace {
+    bool read_spirv(const std::string& path, std::vector<uint32_t>& spirv)
+    {
+        std::string blob;
+        if (!read_file(path, blob) || blob.size() < 4 || blob.size() % 4 != 0)
+            return false;
+        spirv.resize(blob.size() / 4);
+        memcpy(spirv.data(), blob.data(), blob.size());
+        return spirv[0] == SPIRV_MAGIC;
+    }
+
+    //written under a temporary name first, a half written file must never look like a cache hit.
+    //the temporary name is per thread since pipeline jobs may compile the same shader at once
+    void write_spirv(const std::filesystem::path& path, const std::vector<uint32_t>& spirv)
+    {
+        std::filesystem::path tmp = path;
+        tmp += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            file.write((const char*)spirv.data(), spirv.size() * 4);
+        }
+        std::error_code err;
+        std::filesystem::rename(tmp, path, err);
+    }
+
+    VkShaderModule create_module(const std::vector<uint32_t>& spirv)
+    {
+        VkShaderModuleCreateInfo info = {.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        info.codeSize                 = spirv.size() * 4;
+        info.pCode                    = spirv.data();
+        VkShaderModule module;
+        VK_CHECK(vkCreateShaderModule(spock::ctx.device, &info, nullptr, &module));
+        return module;
+    }
+}
+
+VkShaderModule vkengine::load_shader_module(const char* path, const std::vector<std::string>& defines)
+{
+    auto start = stc::steady_clock::now();
+
+    std::vector<uint32_t> spirv;
+    //the build compiles every shader without defines next to its source, use that when we can so
+    //startup never reads or hashes the glsl
+    if (defines.empty() && read_spirv(std::string(path) + ".spv", spirv))
+    {
+        VkShaderModule module = create_module(spirv);
+        double         ms     = stc::duration<double, std::milli>(stc::steady_clock::now() - start).count();
+        {
+            std::lock_guard lock(statsMutex);
+            shaderCacheStats.prebuilt++;
+            shaderCacheStats.loadMs += ms;
+        }
+        return module;
+    }
+
+    std::string source;
+    if (!read_file(path, source))
+    {
+        printf("Failed to read shader %s\n", path);
+        abort();
+    }
+
+    const EShLanguage stage    = stage_from_path(path);
+    const std::string preamble = make_preamble(defines);
+    char              name[32];
+    snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)cache_key(path, stage, source, preamble));
+    const std::filesystem::path cached = std::filesystem::path(SHADER_CACHE_DIR) / name;
+
+    bool hit = read_spirv(cached.string(), spirv);
+
+    if (!hit)
+    {
+        spirv = compile_shader(path, defines);
+
+        std::error_code err;
+        std::filesystem::create_directories(SHADER_CACHE_DIR, err);
+        write_spirv(cached, spirv);
+    }
+
+    VkShaderModule module = create_module(spirv);
+
+    double ms = stc::duration<double, std::milli>(stc::steady_clock::now() - start).count();
+    {
+        std::lock_guard lock(statsMutex);
+        (hit ? shaderCacheStats.hits : shaderCacheStats.misses)++;
+        (hit ? shaderCacheStats.loadMs : shaderCacheStats.compileMs) += ms;
+    }
+    //loads are only counted, a compile is worth a line since it is the slow path
+    if (!hit)
+        printf("Compiled shader %s (%.2f ms)\n", path, ms);
+    return module;
+}
+
+VkShaderModule vkengine::reload_shader_module(const char* path)
+{
+    std::vector<uint32_t> spirv;
+    if (!try_compile_shader(path, {}, spirv))
+        return VK_NULL_HANDLE;
+
+    //a stale prebuilt binary would otherwise win over the edited source on the next start
+    std::filesystem::path prebuilt = std::string(path) + ".spv";
+    if (std::filesystem::exists(prebuilt))
+        write_spirv(prebuilt, spirv);
+
+    printf("Reloaded shader %s\n", path);
+    return create_module(spirv);
+}
+
+void vkengine::shutdown_shader_compiler()
+{
+    if (glslangInitialized)
+        glslang::FinalizeProcess();
+}
@@ -0,0 +1,33 @@
+#pragma once
+//Shader module loading with an on disk SPIR-V cache.
+//Compiled SPIR-V is stored under SHADER_CACHE_DIR, keyed by a hash of the source, stage, defines and
+//glslang version. Unchanged shaders are loaded straight from the cache without touching glslang.
+//When the build has prebuilt <shader>.spv next to the source (see vulkanengine_shaders) that is used
+//instead and the source is never read.
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace vkengine {
+    constexpr const char* SHADER_CACHE_DIR = "shader_cache";
+
+    struct ShaderCacheStats {
+        uint32_t prebuilt  = 0;
+        uint32_t hits      = 0;
+        uint32_t misses    = 0;
+        double   loadMs    = 0;
+        double   compileMs = 0;
+    };
+    inline ShaderCacheStats shaderCacheStats;
+
+    //defines are passed as "NAME" or "NAME=VALUE"
+    std::vector<uint32_t> compile_shader(const char* path, const std::vector<std::string>& defines = {});
+    //prints the error and returns false instead of aborting
+    bool                  try_compile_shader(const char* path, const std::vector<std::string>& defines, std::vector<uint32_t>& spirv);
+    VkShaderModule        load_shader_module(const char* path, const std::vector<std::string>& defines = {});
+    //always compiles from source and refreshes the prebuilt .spv if there is one, returns
+    //VK_NULL_HANDLE if the shader does not compile
+    VkShaderModule        reload_shader_module(const char* path);
+    void                  shutdown_shader_compiler();
+}
@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <cstdlib>
+#include "spock/core.hpp"
+#include "spock/internal.hpp"
+#include "uniform_ring.hpp"
+
+using namespace vkengine;
+
+void UniformRing::init(VkDeviceSize bytesPerFrame, uint32_t frameCount, VkBufferUsageFlags usage)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(spock::ctx.physicalDevice, &properties);
+    alignment = properties.limits.minUniformBufferOffsetAlignment;
+    frameSize = (bytesPerFrame + alignment - 1) & ~(alignment - 1);
+
+    buffer = spock::create_buffer(frameSize * frameCount, usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    mapped = (uint8_t*)buffer.info.pMappedData;
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+    {
+        VkBufferDeviceAddressInfo deviceAddressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = buffer.buffer};
+        address = vkGetBufferDeviceAddress(spock::ctx.device, &deviceAddressInfo);
+    }
+    spock::destroyQueue.push(buffer);
+}
+
+void UniformRing::begin_frame(uint32_t frameIndex)
+{
+    frameBegin = frameSize * frameIndex;
+    head       = frameBegin;
+}
+
+uint32_t UniformRing::allocate(VkDeviceSize size, void** dst)
+{
+    VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > frameBegin + frameSize)
+    {
+        printf("Uniform ring out of space: %zu bytes requested, %zu of %zu used\n", size_t(size), size_t(used()), size_t(frameSize));
+        abort();
+    }
+
+    head = offset + size;
+    *dst = mapped + offset;
+    return uint32_t(offset);
+}
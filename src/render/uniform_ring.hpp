@@ -0,0 +1,41 @@
+#pragma once
+//Persistently mapped linear allocator for per frame uniform data.
+//The buffer is split into one region per frame in flight. A frame bumps through its own region and
+//resets it once its fence has been waited on, so pushing data is a memcpy and a dynamic offset.
+#include <cstdint>
+#include <cstring>
+#include <vulkan/vulkan_core.h>
+#include "spock/types.hpp"
+
+namespace vkengine {
+    struct UniformRing {
+        spock::Buffer   buffer;
+        //only set when the buffer was created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+        VkDeviceAddress address = 0;
+
+        void init(VkDeviceSize bytesPerFrame, uint32_t frameCount, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+        //call after the frame's fence has signalled, everything previously pushed for it is overwritten
+        void begin_frame(uint32_t frameIndex);
+
+        //returns the offset of the allocation from the start of the buffer
+        uint32_t allocate(VkDeviceSize size, void** dst);
+
+        template <typename T>
+        uint32_t push(const T& data)
+        {
+            void*    dst;
+            uint32_t offset = allocate(sizeof(T), &dst);
+            memcpy(dst, &data, sizeof(T));
+            return offset;
+        }
+
+        VkDeviceSize used() const { return head - frameBegin; }
+
+      private:
+        uint8_t*     mapped     = nullptr;
+        VkDeviceSize alignment  = 0;
+        VkDeviceSize frameSize  = 0;
+        VkDeviceSize frameBegin = 0;
+        VkDeviceSize head       = 0;
+    };
+}